@@ -0,0 +1,106 @@
+#include "DeflateCodec.h"
+
+#include <zlib.h>
+
+namespace {
+// zlib 优先匹配字典末尾, 最常出现的片段放在最后
+const char kDictionary[] =
+    "\"device\":\"\"property\":\"\"state\":\"\"value\":\"timestamp\":"
+    "\"exposure\":\"temperature\":\"camera\"mount\"focuser\"filterwheel"
+    "\"guider\"dome\"ra\":\"dec\":\"name\":\"type\":\"status\":\"ok\""
+    "\"error\":\"message\":null,false,true,"
+    "{\"channel\":\"\",\"data\":{\"\",\"messageId\":\"0000000000000000\","
+    "\"priority\":1,\"requiresAck\":false}";
+
+// raw deflate, 不带 zlib 头和校验和, 完整性由传输层保证
+constexpr int kWindowBits = -15;
+constexpr int kMemLevel = 8;
+}  // namespace
+
+struct DeflateCodec::Streams {
+    z_stream deflate{};
+    z_stream inflate{};
+    bool deflateReady = false;
+    bool inflateReady = false;
+};
+
+DeflateCodec::DeflateCodec(int level) : m_streams(new Streams) {
+    m_streams->deflateReady =
+        deflateInit2(&m_streams->deflate, level, Z_DEFLATED, kWindowBits,
+                     kMemLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+    m_streams->inflateReady =
+        inflateInit2(&m_streams->inflate, kWindowBits) == Z_OK;
+}
+
+DeflateCodec::~DeflateCodec() {
+    if (m_streams->deflateReady) {
+        deflateEnd(&m_streams->deflate);
+    }
+    if (m_streams->inflateReady) {
+        inflateEnd(&m_streams->inflate);
+    }
+}
+
+QByteArray DeflateCodec::compress(const QByteArray &data) {
+    z_stream &stream = m_streams->deflate;
+    if (!m_streams->deflateReady || deflateReset(&stream) != Z_OK ||
+        deflateSetDictionary(
+            &stream, reinterpret_cast<const Bytef *>(kDictionary),
+            sizeof(kDictionary) - 1) != Z_OK) {
+        return QByteArray();
+    }
+
+    QByteArray out(static_cast<qsizetype>(
+                       deflateBound(&stream, static_cast<uLong>(data.size()))),
+                   Qt::Uninitialized);
+    stream.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        return QByteArray();
+    }
+    out.truncate(static_cast<qsizetype>(stream.total_out));
+    return out;
+}
+
+bool DeflateCodec::decompress(const QByteArray &data, QByteArray *out,
+                              int maxOutputSize) {
+    z_stream &stream = m_streams->inflate;
+    // raw deflate 不会请求字典, 需在开始前主动设置
+    if (!m_streams->inflateReady || inflateReset(&stream) != Z_OK ||
+        inflateSetDictionary(
+            &stream, reinterpret_cast<const Bytef *>(kDictionary),
+            sizeof(kDictionary) - 1) != Z_OK) {
+        return false;
+    }
+
+    out->resize(qMin<qsizetype>(qMax<qsizetype>(data.size() * 4, 256),
+                                maxOutputSize));
+    stream.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    for (;;) {
+        const qsizetype produced = static_cast<qsizetype>(stream.total_out);
+        stream.next_out = reinterpret_cast<Bytef *>(out->data() + produced);
+        stream.avail_out = static_cast<uInt>(out->size() - produced);
+
+        const int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            out->truncate(static_cast<qsizetype>(stream.total_out));
+            return true;
+        }
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            return false;
+        }
+        if (stream.avail_out > 0) {
+            return false;  // 输入已耗尽但流未结束, 数据被截断
+        }
+        if (out->size() >= maxOutputSize) {
+            return false;
+        }
+        out->resize(qMin<qsizetype>(out->size() * 2, maxOutputSize));
+    }
+}
\ No newline at end of file
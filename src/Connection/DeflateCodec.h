@@ -0,0 +1,35 @@
+#ifndef DEFLATECODEC_H
+#define DEFLATECODEC_H
+
+#include <QByteArray>
+#include <memory>
+
+// 逐条消息的 raw deflate 压缩, 使用预置字典 (常见的 JSON 键名),
+// 小消息也能获得可观的压缩率. 每条消息独立压缩, 不依赖上下文,
+// 压缩/解压流在消息之间复用, 只做 reset 而不重新分配.
+// 字典内容变化时必须同时修改 DictionaryVersion 和 Name.
+// 压缩与解压可分别在不同线程使用, 但各自不可并发.
+class DeflateCodec {
+public:
+    static constexpr char Name[] = "deflate-v1";
+    static constexpr quint8 DictionaryVersion = 1;
+    static constexpr int DefaultMaxOutputSize = 64 * 1024 * 1024;
+
+    explicit DeflateCodec(int level = 6);
+    ~DeflateCodec();
+
+    DeflateCodec(const DeflateCodec &) = delete;
+    DeflateCodec &operator=(const DeflateCodec &) = delete;
+
+    // 失败时返回空数组
+    QByteArray compress(const QByteArray &data);
+    // 输出超过 maxOutputSize 时视为失败, 防止解压炸弹
+    bool decompress(const QByteArray &data, QByteArray *out,
+                    int maxOutputSize = DefaultMaxOutputSize);
+
+private:
+    struct Streams;
+    std::unique_ptr<Streams> m_streams;
+};
+
+#endif  // DEFLATECODEC_H
\ No newline at end of file
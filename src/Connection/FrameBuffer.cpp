@@ -0,0 +1,129 @@
+#include "FrameBuffer.h"
+
+#include <QtEndian>
+
+namespace {
+constexpr int kLengthPrefixSize = 4;
+}
+
+FrameBuffer::FrameBuffer(Mode mode, int maxFrameSize)
+    : m_mode(mode), m_maxFrameSize(maxFrameSize), m_offset(0), m_error(false) {}
+
+void FrameBuffer::setMode(Mode mode) {
+    m_mode = mode;
+    clear();
+}
+
+void FrameBuffer::setMaxFrameSize(int bytes) { m_maxFrameSize = bytes; }
+
+void FrameBuffer::append(const QByteArray &data) {
+    if (m_error || data.isEmpty()) {
+        return;
+    }
+
+    if (m_offset == m_buffer.size()) {
+        // 上次已全部消费: 直接接管新数据, 利用隐式共享避免拷贝
+        m_buffer = data;
+        m_offset = 0;
+        return;
+    }
+
+    if (m_offset > 0 && m_offset >= m_buffer.size() / 2) {
+        m_buffer.remove(0, m_offset);
+        m_offset = 0;
+    }
+    m_buffer.append(data);
+}
+
+bool FrameBuffer::nextFrame(QByteArray *frame) {
+    if (m_error || m_offset >= m_buffer.size()) {
+        return false;
+    }
+
+    const int available = m_buffer.size() - m_offset;
+
+    switch (m_mode) {
+        case NoFraming:
+            *frame = m_offset == 0 ? m_buffer : m_buffer.mid(m_offset);
+            m_offset = m_buffer.size();
+            return true;
+
+        case LengthPrefixed: {
+            if (available < kLengthPrefixSize) {
+                return false;
+            }
+            const quint32 length = qFromBigEndian<quint32>(
+                reinterpret_cast<const uchar *>(m_buffer.constData() +
+                                                m_offset));
+            if (length > static_cast<quint32>(m_maxFrameSize)) {
+                m_error = true;
+                return false;
+            }
+            if (available - kLengthPrefixSize < static_cast<int>(length)) {
+                return false;
+            }
+            *frame = m_buffer.mid(m_offset + kLengthPrefixSize,
+                                  static_cast<int>(length));
+            m_offset += kLengthPrefixSize + static_cast<int>(length);
+            return true;
+        }
+
+        case NewlineDelimited: {
+            const int end = m_buffer.indexOf('\n', m_offset);
+            if (end < 0) {
+                if (available > m_maxFrameSize) {
+                    m_error = true;
+                }
+                return false;
+            }
+            int length = end - m_offset;
+            if (length > 0 && m_buffer.at(end - 1) == '\r') {
+                --length;
+            }
+            *frame = m_buffer.mid(m_offset, length);
+            m_offset = end + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameBuffer::clear() {
+    m_buffer.clear();
+    m_offset = 0;
+    m_error = false;
+}
+
+QByteArray FrameBuffer::encode(const QByteArray &payload, Mode mode) {
+    switch (mode) {
+        case LengthPrefixed: {
+            QByteArray frame;
+            frame.reserve(kLengthPrefixSize + payload.size());
+            frame.resize(kLengthPrefixSize);
+            qToBigEndian<quint32>(static_cast<quint32>(payload.size()),
+                                  reinterpret_cast<uchar *>(frame.data()));
+            frame.append(payload);
+            return frame;
+        }
+        case NewlineDelimited:
+            return payload + '\n';
+        case NoFraming:
+            break;
+    }
+    return payload;
+}
+
+QByteArray FrameBuffer::encodeHead(const QByteArray &header,
+                                   qsizetype payloadSize, Mode mode) {
+    if (mode != LengthPrefixed) {
+        return header;
+    }
+
+    QByteArray head;
+    head.reserve(kLengthPrefixSize + header.size());
+    head.resize(kLengthPrefixSize);
+    qToBigEndian<quint32>(static_cast<quint32>(header.size() + payloadSize),
+                          reinterpret_cast<uchar *>(head.data()));
+    head.append(header);
+    return head;
+}
\ No newline at end of file
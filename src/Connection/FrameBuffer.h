@@ -0,0 +1,49 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <QByteArray>
+
+// 流式传输的分帧与重组缓冲区
+// 读取时只移动偏移量, 已消费的数据超过缓冲区一半时才整体压缩一次,
+// 因此一次 readyRead 中的多个帧不会反复拷贝剩余数据
+class FrameBuffer {
+public:
+    enum Mode {
+        NoFraming,         // 每次读取的数据视为一个帧 (旧行为)
+        LengthPrefixed,    // 4 字节大端长度前缀 + 负载
+        NewlineDelimited   // 以 '\n' 结尾, 仅适用于文本负载
+    };
+
+    static constexpr int DefaultMaxFrameSize = 64 * 1024 * 1024;
+
+    explicit FrameBuffer(Mode mode = NoFraming,
+                         int maxFrameSize = DefaultMaxFrameSize);
+
+    void setMode(Mode mode);
+    Mode mode() const { return m_mode; }
+    void setMaxFrameSize(int bytes);
+
+    void append(const QByteArray &data);
+    // 取出下一个完整帧, 数据不足或出错时返回 false
+    bool nextFrame(QByteArray *frame);
+
+    // 帧长度超限等不可恢复错误, 需调用 clear() 后才能继续使用
+    bool hasError() const { return m_error; }
+    void clear();
+    int bufferedBytes() const { return m_buffer.size() - m_offset; }
+
+    static QByteArray encode(const QByteArray &payload, Mode mode);
+    // 分段写出时负载之前的部分 (长度前缀 + header), 负载本身无需拷贝;
+    // NewlineDelimited 模式下负载之后还需写出 '\n'
+    static QByteArray encodeHead(const QByteArray &header,
+                                 qsizetype payloadSize, Mode mode);
+
+private:
+    Mode m_mode;
+    int m_maxFrameSize;
+    QByteArray m_buffer;
+    int m_offset;
+    bool m_error;
+};
+
+#endif  // FRAMEBUFFER_H
\ No newline at end of file
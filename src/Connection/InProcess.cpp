@@ -0,0 +1,107 @@
+#include "InProcess.h"
+
+#include <QtGlobal>
+
+namespace {
+// 总是投递到端点所在线程再发出, 同线程时也不会在发送方调用栈内重入
+template <typename Signal>
+void postSignal(InProcessEndpoint *endpoint, Signal signal) {
+    QMetaObject::invokeMethod(
+        endpoint, [endpoint, signal]() { (endpoint->*signal)(); },
+        Qt::QueuedConnection);
+}
+}  // namespace
+
+InProcessEndpoint::InProcessEndpoint(QObject *parent)
+    : QObject(parent), m_side(0) {}
+
+InProcessEndpoint::~InProcessEndpoint() { detach(false); }
+
+void InProcessEndpoint::connectPair(InProcessEndpoint *first,
+                                    InProcessEndpoint *second, int capacity) {
+    first->disconnectFromPeer();
+    second->disconnectFromPeer();
+
+    auto link =
+        std::make_shared<Link>(static_cast<std::size_t>(qMax(1, capacity)));
+    link->ends[0] = first;
+    link->ends[1] = second;
+    first->m_link = link;
+    first->m_side = 0;
+    second->m_link = link;
+    second->m_side = 1;
+    postSignal(first, &InProcessEndpoint::connected);
+    postSignal(second, &InProcessEndpoint::connected);
+}
+
+void InProcessEndpoint::disconnectFromPeer() { detach(true); }
+
+bool InProcessEndpoint::isConnected() const {
+    return m_link && m_link->open.load(std::memory_order_acquire);
+}
+
+bool InProcessEndpoint::sendFrame(const QByteArray &frame) {
+    if (!isConnected()) {
+        return false;
+    }
+
+    const int other = 1 - m_side;
+    SpscRing<QByteArray> &ring = m_link->rings[other];
+    if (!ring.tryPush(frame)) {
+        // 先登记再重试, 对端在两者之间读空时也能收到 writable 通知
+        m_link->writeBlocked[m_side] = true;
+        if (!ring.tryPush(frame)) {
+            return false;
+        }
+    }
+
+    if (!m_link->readScheduled[other].exchange(true)) {
+        if (InProcessEndpoint *target = m_link->ends[other]) {
+            postSignal(target, &InProcessEndpoint::readyRead);
+        }
+    }
+    return true;
+}
+
+bool InProcessEndpoint::takeFrame(QByteArray *frame) {
+    if (!m_link) {
+        return false;
+    }
+
+    SpscRing<QByteArray> &ring = m_link->rings[m_side];
+    if (ring.tryPop(frame)) {
+        return true;
+    }
+
+    // 先清除标志再复查, 保证清除之后写入的帧一定会再次通知
+    m_link->readScheduled[m_side] = false;
+    if (ring.tryPop(frame)) {
+        return true;
+    }
+
+    const int other = 1 - m_side;
+    if (m_link->writeBlocked[other].exchange(false)) {
+        if (InProcessEndpoint *target = m_link->ends[other]) {
+            postSignal(target, &InProcessEndpoint::writable);
+        }
+    }
+    return false;
+}
+
+void InProcessEndpoint::detach(bool notifySelf) {
+    if (!m_link) {
+        return;
+    }
+
+    const std::shared_ptr<Link> link = std::move(m_link);
+    link->ends[m_side] = nullptr;
+    if (!link->open.exchange(false)) {
+        return;  // 对端已先断开
+    }
+    if (InProcessEndpoint *other = link->ends[1 - m_side]) {
+        postSignal(other, &InProcessEndpoint::disconnected);
+    }
+    if (notifySelf) {
+        emit disconnected();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef INPROCESSENDPOINT_H
+#define INPROCESSENDPOINT_H
+
+#include <QByteArray>
+#include <QObject>
+#include <atomic>
+#include <memory>
+
+#include "Utils/SpscRing.h"
+
+// 进程内传输端点: 两个端点通过一对无锁环形缓冲区直接交换帧,
+// 不经过套接字, 可位于不同线程. 每个方向只允许一个发送线程
+// (端点所在线程). connectPair/disconnectFromPeer 应在两端空闲时调用.
+class InProcessEndpoint : public QObject {
+    Q_OBJECT
+
+public:
+    explicit InProcessEndpoint(QObject *parent = nullptr);
+    ~InProcessEndpoint();
+
+    // capacity 为每个方向最多积压的帧数
+    static void connectPair(InProcessEndpoint *first,
+                            InProcessEndpoint *second, int capacity = 4096);
+    void disconnectFromPeer();
+    bool isConnected() const;
+
+    // 对端缓冲区已满或未连接时返回 false, 帧不会被保留
+    bool sendFrame(const QByteArray &frame);
+    // 在 readyRead 之后循环调用直到返回 false
+    bool takeFrame(QByteArray *frame);
+
+signals:
+    void connected();
+    void disconnected();
+    // 每批帧只发出一次, 读取完毕后才会再次发出
+    void readyRead();
+    // 之前因对端缓冲区满而发送失败, 现在已有空间
+    void writable();
+
+private:
+    struct Link {
+        explicit Link(std::size_t capacity)
+            : rings{SpscRing<QByteArray>(capacity),
+                    SpscRing<QByteArray>(capacity)} {}
+
+        // rings[i] 存放发往端点 i 的帧
+        SpscRing<QByteArray> rings[2];
+        std::atomic<bool> readScheduled[2] = {false, false};
+        std::atomic<bool> writeBlocked[2] = {false, false};
+        std::atomic<bool> open{true};
+        std::atomic<InProcessEndpoint *> ends[2] = {nullptr, nullptr};
+    };
+
+    // 两端共享, 一端断开后另一端仍可读完剩余的帧
+    std::shared_ptr<Link> m_link;
+    int m_side;
+
+    void detach(bool notifySelf);
+};
+
+#endif  // INPROCESSENDPOINT_H
\ No newline at end of file
@@ -0,0 +1,410 @@
+#include "StreamDecoder.h"
+
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QtEndian>
+
+namespace {
+bool isJsonSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+constexpr uchar kCborBreak = 0xFF;
+constexpr int kCborMajorArray = 4;
+}  // namespace
+
+StreamDecoder::StreamDecoder(Format format, int maxRecordSize)
+    : m_format(format),
+      m_maxRecordSize(maxRecordSize),
+      m_splitTopLevelArrays(true),
+      m_scanPos(0),
+      m_recordStart(-1),
+      m_inTopArray(false),
+      m_error(false),
+      m_malformedRecords(0),
+      m_depth(0),
+      m_inString(false),
+      m_escape(false),
+      m_scalar(false),
+      m_cborSkip(0),
+      m_topArrayRemaining(0) {}
+
+void StreamDecoder::setFormat(Format format) {
+    m_format = format;
+    clear();
+}
+
+void StreamDecoder::setSplitTopLevelArrays(bool split) {
+    m_splitTopLevelArrays = split;
+    clear();
+}
+
+void StreamDecoder::setMaxRecordSize(int bytes) { m_maxRecordSize = bytes; }
+
+void StreamDecoder::append(const QByteArray &data) {
+    if (m_error || data.isEmpty()) {
+        return;
+    }
+
+    // 当前记录起点之前的数据都已不再需要
+    const qsizetype consumed = m_recordStart >= 0 ? m_recordStart : m_scanPos;
+    if (consumed == m_buffer.size()) {
+        m_buffer = data;
+        m_scanPos = 0;
+        m_recordStart = -1;
+        return;
+    }
+
+    if (consumed > 0 && consumed >= m_buffer.size() / 2) {
+        m_buffer.remove(0, consumed);
+        m_scanPos -= consumed;
+        if (m_recordStart >= 0) {
+            m_recordStart -= consumed;
+        }
+    }
+    m_buffer.append(data);
+}
+
+bool StreamDecoder::nextRecord(QVariant *record) {
+    while (!m_error) {
+        qsizetype end = 0;
+        const bool complete =
+            m_format == Json ? scanJson(&end) : scanCbor(&end);
+        if (m_error) {
+            return false;
+        }
+        if (!complete) {
+            if (m_recordStart >= 0 &&
+                m_scanPos - m_recordStart > m_maxRecordSize) {
+                fail("record exceeds maximum size");
+            }
+            return false;
+        }
+
+        // 解析结果会复制所需数据, 直接引用缓冲区即可
+        const QByteArray bytes = QByteArray::fromRawData(
+            m_buffer.constData() + m_recordStart, end - m_recordStart);
+        m_recordStart = -1;
+        if (decode(bytes, record)) {
+            return true;
+        }
+        ++m_malformedRecords;
+    }
+    return false;
+}
+
+void StreamDecoder::clear() {
+    m_buffer.clear();
+    m_scanPos = 0;
+    m_recordStart = -1;
+    m_inTopArray = false;
+    m_error = false;
+    m_errorString.clear();
+    resetScanState();
+}
+
+int StreamDecoder::bufferedBytes() const {
+    const qsizetype start = m_recordStart >= 0 ? m_recordStart : m_scanPos;
+    return static_cast<int>(m_buffer.size() - start);
+}
+
+void StreamDecoder::resetScanState() {
+    m_depth = 0;
+    m_inString = false;
+    m_escape = false;
+    m_scalar = false;
+    m_cborPending.clear();
+    m_cborSkip = 0;
+    m_topArrayRemaining = 0;
+}
+
+void StreamDecoder::fail(const QString &message) {
+    m_error = true;
+    m_errorString = message;
+}
+
+bool StreamDecoder::scanJson(qsizetype *recordEnd) {
+    const char *data = m_buffer.constData();
+    const qsizetype size = m_buffer.size();
+    while (m_scanPos < size) {
+        const char c = data[m_scanPos];
+
+        if (m_inString) {
+            ++m_scanPos;
+            if (m_escape) {
+                m_escape = false;
+            } else if (c == '\\') {
+                m_escape = true;
+            } else if (c == '"') {
+                m_inString = false;
+                if (m_depth == 0) {
+                    *recordEnd = m_scanPos;
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        if (m_recordStart < 0) {
+            // 记录之间: 跳过空白, 以及顶层数组的括号和逗号
+            if (isJsonSpace(c)) {
+                ++m_scanPos;
+                continue;
+            }
+            if (m_inTopArray) {
+                if (c == ',') {
+                    ++m_scanPos;
+                    continue;
+                }
+                if (c == ']') {
+                    m_inTopArray = false;
+                    ++m_scanPos;
+                    continue;
+                }
+            } else if (m_splitTopLevelArrays && c == '[') {
+                m_inTopArray = true;
+                ++m_scanPos;
+                continue;
+            }
+            m_recordStart = m_scanPos;
+            m_depth = 0;
+            m_scalar = false;
+        }
+
+        if (m_scalar) {
+            // 分隔符不属于记录本身, 留给下一轮跳过
+            if (isJsonSpace(c) || c == ',' || c == ']' || c == '}') {
+                *recordEnd = m_scanPos;
+                return true;
+            }
+            ++m_scanPos;
+            continue;
+        }
+
+        ++m_scanPos;
+        switch (c) {
+            case '"':
+                m_inString = true;
+                break;
+            case '{':
+            case '[':
+                ++m_depth;
+                break;
+            case '}':
+            case ']':
+                if (--m_depth == 0) {
+                    *recordEnd = m_scanPos;
+                    return true;
+                }
+                if (m_depth < 0) {
+                    fail("unbalanced JSON brackets");
+                    return false;
+                }
+                break;
+            default:
+                if (m_depth == 0) {
+                    m_scalar = true;
+                }
+                break;
+        }
+    }
+    return false;
+}
+
+bool StreamDecoder::completeCborItem() {
+    // 子项完成时逐层递减, 定长容器减到 0 时自身作为父容器的一个子项完成
+    while (!m_cborPending.isEmpty()) {
+        qint64 &remaining = m_cborPending.last();
+        if (remaining < 0 || --remaining > 0) {
+            return false;
+        }
+        m_cborPending.removeLast();
+    }
+    return true;
+}
+
+bool StreamDecoder::scanCbor(qsizetype *recordEnd) {
+    const uchar *data = reinterpret_cast<const uchar *>(m_buffer.constData());
+    const qsizetype size = m_buffer.size();
+    for (;;) {
+        bool itemDone = false;
+
+        if (m_cborSkip > 0) {
+            const qint64 step = qMin<qint64>(m_cborSkip, size - m_scanPos);
+            m_scanPos += step;
+            m_cborSkip -= step;
+            if (m_cborSkip > 0) {
+                return false;
+            }
+            itemDone = true;
+        } else {
+            if (m_scanPos >= size) {
+                return false;
+            }
+            const uchar initial = data[m_scanPos];
+            const int major = initial >> 5;
+            const int info = initial & 0x1F;
+
+            if (m_recordStart < 0) {
+                if (m_inTopArray && m_topArrayRemaining < 0 &&
+                    initial == kCborBreak) {
+                    m_inTopArray = false;
+                    ++m_scanPos;
+                    continue;
+                }
+                if (!m_inTopArray && m_splitTopLevelArrays &&
+                    major == kCborMajorArray) {
+                    // 顶层数组头单独消费, 其元素逐条作为记录
+                    const int headSize = info < 24    ? 1
+                                         : info == 24 ? 2
+                                         : info == 25 ? 3
+                                         : info == 26 ? 5
+                                         : info == 27 ? 9
+                                         : info == 31 ? 1
+                                                      : 0;
+                    if (headSize == 0) {
+                        fail("invalid CBOR header");
+                        return false;
+                    }
+                    if (size - m_scanPos < headSize) {
+                        return false;
+                    }
+                    quint64 count = info;
+                    if (info == 24) {
+                        count = data[m_scanPos + 1];
+                    } else if (info == 25) {
+                        count = qFromBigEndian<quint16>(data + m_scanPos + 1);
+                    } else if (info == 26) {
+                        count = qFromBigEndian<quint32>(data + m_scanPos + 1);
+                    } else if (info == 27) {
+                        count = qFromBigEndian<quint64>(data + m_scanPos + 1);
+                    }
+                    m_scanPos += headSize;
+                    m_topArrayRemaining =
+                        info == 31 ? -1 : static_cast<qint64>(count);
+                    m_inTopArray = m_topArrayRemaining != 0;
+                    continue;
+                }
+                m_recordStart = m_scanPos;
+            }
+
+            if (initial == kCborBreak) {
+                if (m_cborPending.isEmpty() || m_cborPending.last() >= 0) {
+                    fail("unexpected CBOR break");
+                    return false;
+                }
+                ++m_scanPos;
+                m_cborPending.removeLast();
+                itemDone = true;
+            } else {
+                const int argSize = info < 24    ? 0
+                                    : info == 24 ? 1
+                                    : info == 25 ? 2
+                                    : info == 26 ? 4
+                                    : info == 27 ? 8
+                                    : info == 31 ? 0
+                                                 : -1;
+                const bool indefinite = info == 31;
+                if (argSize < 0 ||
+                    (indefinite && (major < 2 || major > 5))) {
+                    fail("invalid CBOR header");
+                    return false;
+                }
+                if (size - m_scanPos < 1 + argSize) {
+                    return false;
+                }
+
+                quint64 argument = indefinite ? 0 : info;
+                const uchar *in = data + m_scanPos + 1;
+                if (argSize == 1) {
+                    argument = in[0];
+                } else if (argSize == 2) {
+                    argument = qFromBigEndian<quint16>(in);
+                } else if (argSize == 4) {
+                    argument = qFromBigEndian<quint32>(in);
+                } else if (argSize == 8) {
+                    argument = qFromBigEndian<quint64>(in);
+                }
+                m_scanPos += 1 + argSize;
+
+                switch (major) {
+                    case 2:
+                    case 3:
+                        if (indefinite) {
+                            m_cborPending.append(-1);
+                        } else if (argument >
+                                   static_cast<quint64>(m_maxRecordSize)) {
+                            fail("record exceeds maximum size");
+                            return false;
+                        } else if (argument > 0) {
+                            m_cborSkip = static_cast<qint64>(argument);
+                        } else {
+                            itemDone = true;
+                        }
+                        break;
+                    case 4:
+                    case 5: {
+                        if (indefinite) {
+                            m_cborPending.append(-1);
+                            break;
+                        }
+                        if (argument >
+                            static_cast<quint64>(m_maxRecordSize)) {
+                            fail("record exceeds maximum size");
+                            return false;
+                        }
+                        const qint64 children = static_cast<qint64>(argument) *
+                                                (major == 5 ? 2 : 1);
+                        if (children > 0) {
+                            m_cborPending.append(children);
+                        } else {
+                            itemDone = true;
+                        }
+                        break;
+                    }
+                    case 6:
+                        // 标签与其后的数据项合为一项
+                        break;
+                    default:
+                        itemDone = true;
+                        break;
+                }
+            }
+        }
+
+        if (itemDone && completeCborItem()) {
+            *recordEnd = m_scanPos;
+            if (m_inTopArray && m_topArrayRemaining > 0 &&
+                --m_topArrayRemaining == 0) {
+                m_inTopArray = false;
+            }
+            return true;
+        }
+    }
+}
+
+bool StreamDecoder::decode(const QByteArray &bytes, QVariant *record) const {
+    if (m_format == Cbor) {
+        QCborParserError error;
+        const QCborValue value = QCborValue::fromCbor(bytes, &error);
+        if (error.error != QCborError::NoError) {
+            return false;
+        }
+        *record = value.toVariant();
+        return true;
+    }
+
+    // QJsonDocument 只接受对象和数组, 标量包一层数组再取出
+    const char lead = bytes.at(0);
+    const bool container = lead == '{' || lead == '[';
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(
+        container ? bytes : '[' + bytes + ']', &error);
+    if (error.error != QJsonParseError::NoError) {
+        return false;
+    }
+    *record = container ? document.toVariant()
+                        : document.array().at(0).toVariant();
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef STREAMDECODER_H
+#define STREAMDECODER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+// 无分帧字节流的增量解码器: 输入连续的 JSON 值或 CBOR 序列 (RFC 8742),
+// 边到达边扫描记录边界, 由调用方逐条拉取.
+// 扫描状态可跨 append 保留, 每个字节只扫描一次; 已取出的记录随即释放,
+// 内存占用取决于单条记录而不是整个传输.
+// 开启 splitTopLevelArrays 时顶层数组 (如 [ {...}, {...} ] 形式的设备目录)
+// 的每个元素作为一条记录输出, 不必等整个数组传完.
+// JSON 顶层的数字/true/false/null 需要后续分隔符 (空白或 ',') 才算完整.
+class StreamDecoder {
+public:
+    enum Format { Json, Cbor };
+
+    static constexpr int DefaultMaxRecordSize = 64 * 1024 * 1024;
+
+    explicit StreamDecoder(Format format = Json,
+                           int maxRecordSize = DefaultMaxRecordSize);
+
+    void setFormat(Format format);
+    Format format() const { return m_format; }
+    void setSplitTopLevelArrays(bool split);
+    void setMaxRecordSize(int bytes);
+
+    void append(const QByteArray &data);
+    // 取出下一条完整记录, 数据不足或出错时返回 false.
+    // 边界正确但内容无法解析的记录会被跳过并计数
+    bool nextRecord(QVariant *record);
+
+    // 结构错误或记录超长, 需调用 clear() 后才能继续使用
+    bool hasError() const { return m_error; }
+    QString errorString() const { return m_errorString; }
+    quint64 malformedRecords() const { return m_malformedRecords; }
+    void clear();
+    int bufferedBytes() const;
+
+private:
+    Format m_format;
+    int m_maxRecordSize;
+    bool m_splitTopLevelArrays;
+
+    QByteArray m_buffer;
+    qsizetype m_scanPos;      // 下一个待扫描的字节
+    qsizetype m_recordStart;  // 当前记录起点, -1 表示位于记录之间
+    bool m_inTopArray;
+    bool m_error;
+    QString m_errorString;
+    quint64 m_malformedRecords;
+
+    // JSON 扫描状态
+    int m_depth;
+    bool m_inString;
+    bool m_escape;
+    bool m_scalar;
+
+    // CBOR 扫描状态: 各层容器剩余的子项数, -1 表示不定长
+    QVector<qint64> m_cborPending;
+    qint64 m_cborSkip;           // 字符串剩余的负载字节
+    qint64 m_topArrayRemaining;  // 顶层数组剩余元素, -1 表示不定长
+
+    bool scanJson(qsizetype *recordEnd);
+    bool scanCbor(qsizetype *recordEnd);
+    bool completeCborItem();
+    bool decode(const QByteArray &bytes, QVariant *record) const;
+    void fail(const QString &message);
+    void resetScanState();
+};
+
+#endif  // STREAMDECODER_H
\ No newline at end of file
@@ -1,15 +1,33 @@
 #include "Tcp.h"
 #include <QDebug>
 
+namespace {
+// 不小于此大小的 QByteArray 由套接字写缓冲区直接引用 (隐式共享), 不参与合并
+constexpr qsizetype kZeroCopyWriteSize = 4096;
+constexpr int kLowLatencyCoalesceBytes = 16 * 1024;
+constexpr int kThroughputCoalesceBytes = 256 * 1024;
+constexpr qint64 kDefaultSendQueueLimit = 16 * 1024 * 1024;
+}  // namespace
+
 TcpClient::TcpClient(QObject *parent)
     : QObject(parent),
       m_socket(new QTcpSocket(this)),
       m_port(0),
-      m_autoReconnect(false) {
+      m_autoReconnect(false),
+      m_reconnectTimer(this),
+      m_heartbeatTimer(this),
+      m_streamDecoding(false),
+      m_sendQueueLimit(kDefaultSendQueueLimit),
+      m_replayPolicy(ReplayAll),
+      m_replayLatestCount(0),
+      m_writeMode(LowLatency),
+      m_flushTimer(this) {
     connect(m_socket, &QTcpSocket::connected, this, &TcpClient::onConnected);
     connect(m_socket, &QTcpSocket::disconnected, this,
             &TcpClient::onDisconnected);
     connect(m_socket, &QTcpSocket::readyRead, this, &TcpClient::onReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this,
+            &TcpClient::bytesWritten);
     connect(m_socket, &QTcpSocket::errorOccurred, this, &TcpClient::onError);
 
     m_reconnectTimer.setSingleShot(true);
@@ -18,6 +36,10 @@ TcpClient::TcpClient(QObject *parent)
 
     connect(&m_heartbeatTimer, &QTimer::timeout, this,
             &TcpClient::sendHeartbeat);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(0);
+    connect(&m_flushTimer, &QTimer::timeout, this, &TcpClient::flush);
 }
 
 TcpClient::~TcpClient() { disconnectFromHost(); }
@@ -28,14 +50,89 @@ void TcpClient::connectToHost(const QString &host, quint16 port) {
     m_socket->connectToHost(host, port);
 }
 
-void TcpClient::disconnectFromHost() { m_socket->disconnectFromHost(); }
+void TcpClient::disconnectFromHost() {
+    // 断开前写出合并缓冲区, disconnectFromHost 会等待写缓冲区发送完毕
+    flush();
+    m_socket->disconnectFromHost();
+}
 
 void TcpClient::sendData(const QByteArray &data) {
-    if (m_socket->state() == QAbstractSocket::ConnectedState) {
+    QueuedFrame frame;
+    frame.head = FrameBuffer::encode(data, m_readBuffer.mode());
+    submitFrame(frame);
+}
+
+void TcpClient::sendFrame(const QByteArray &header,
+                          const QByteArray &payload) {
+    const FrameBuffer::Mode mode = m_readBuffer.mode();
+    QueuedFrame frame;
+    frame.head = FrameBuffer::encodeHead(header, payload.size(), mode);
+    frame.payload = payload;
+    frame.newline = mode == FrameBuffer::NewlineDelimited;
+    submitFrame(frame);
+}
+
+void TcpClient::submitFrame(const QueuedFrame &frame) {
+    if (m_socket->state() != QAbstractSocket::ConnectedState) {
+        enqueueFrame(frame);
+        return;
+    }
+
+    writeChunk(frame.head);
+    if (!frame.payload.isEmpty()) {
+        writeChunk(frame.payload);
+    }
+    if (frame.newline) {
+        writeChunk(QByteArray(1, '\n'));
+    }
+}
+
+void TcpClient::enqueueFrame(const QueuedFrame &frame) {
+    const qsizetype size = frame.size();
+    if (m_sendQueueLimit > 0 && size > m_sendQueueLimit) {
+        ++m_sendQueueStats.droppedFrames;
+        m_sendQueueStats.droppedBytes += size;
+        return;
+    }
+
+    while (m_sendQueueLimit > 0 &&
+           m_sendQueueStats.queuedBytes + size > m_sendQueueLimit) {
+        dropOldestFrame();
+    }
+    m_sendQueue.enqueue(frame);
+    m_sendQueueStats.queuedBytes += size;
+}
+
+void TcpClient::dropOldestFrame() {
+    const qsizetype size = m_sendQueue.dequeue().size();
+    m_sendQueueStats.queuedBytes -= size;
+    ++m_sendQueueStats.droppedFrames;
+    m_sendQueueStats.droppedBytes += size;
+}
+
+void TcpClient::writeChunk(const QByteArray &data) {
+    if (data.size() >= kZeroCopyWriteSize) {
+        // 先写出已合并的数据以保持顺序
+        flush();
         m_socket->write(data);
-    } else {
-        m_sendQueue.enqueue(data);
+        return;
+    }
+
+    m_pendingWrite.append(data);
+    if (m_pendingWrite.size() >= coalesceThreshold()) {
+        flush();
+    } else if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void TcpClient::flush() {
+    m_flushTimer.stop();
+    if (m_pendingWrite.isEmpty()) {
+        return;
     }
+    m_socket->write(m_pendingWrite);
+    m_pendingWrite.clear();
 }
 
 bool TcpClient::isConnected() const {
@@ -56,7 +153,62 @@ void TcpClient::setHeartbeatInterval(int msecs) {
     }
 }
 
+void TcpClient::setFramingMode(FrameBuffer::Mode mode) {
+    m_readBuffer.setMode(mode);
+}
+
+FrameBuffer::Mode TcpClient::framingMode() const { return m_readBuffer.mode(); }
+
+void TcpClient::setStreamDecoding(bool enable, StreamDecoder::Format format,
+                                  bool splitTopLevelArrays) {
+    m_streamDecoding = enable;
+    m_streamDecoder.setFormat(format);
+    m_streamDecoder.setSplitTopLevelArrays(splitTopLevelArrays);
+}
+
+void TcpClient::setWriteMode(WriteMode mode) {
+    m_writeMode = mode;
+    if (isConnected()) {
+        applyWriteMode();
+    }
+}
+
+TcpClient::WriteMode TcpClient::writeMode() const { return m_writeMode; }
+
+void TcpClient::setSendQueueLimit(qint64 maxBytes) {
+    m_sendQueueLimit = maxBytes;
+    while (m_sendQueueLimit > 0 &&
+           m_sendQueueStats.queuedBytes > m_sendQueueLimit) {
+        dropOldestFrame();
+    }
+}
+
+void TcpClient::setReplayPolicy(ReplayPolicy policy, int latestCount) {
+    m_replayPolicy = policy;
+    m_replayLatestCount = qMax(0, latestCount);
+}
+
+TcpClient::SendQueueStats TcpClient::sendQueueStats() const {
+    SendQueueStats stats = m_sendQueueStats;
+    stats.queuedFrames = m_sendQueue.size();
+    stats.limitBytes = m_sendQueueLimit;
+    return stats;
+}
+
+void TcpClient::applyWriteMode() {
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption,
+                              m_writeMode == LowLatency ? 1 : 0);
+}
+
+int TcpClient::coalesceThreshold() const {
+    return m_writeMode == LowLatency ? kLowLatencyCoalesceBytes
+                                     : kThroughputCoalesceBytes;
+}
+
 void TcpClient::onConnected() {
+    m_readBuffer.clear();
+    m_streamDecoder.clear();
+    applyWriteMode();
     qDebug() << "Connected to host";
     emit connected();
     processQueue();
@@ -64,6 +216,9 @@ void TcpClient::onConnected() {
 
 void TcpClient::onDisconnected() {
     qDebug() << "Disconnected from host";
+    // 与套接字写缓冲区中未发出的数据一样丢弃
+    m_flushTimer.stop();
+    m_pendingWrite.clear();
     emit disconnected();
 
     if (m_autoReconnect) {
@@ -72,8 +227,41 @@ void TcpClient::onDisconnected() {
 }
 
 void TcpClient::onReadyRead() {
-    QByteArray data = m_socket->readAll();
-    emit dataReceived(data);
+    if (m_streamDecoding) {
+        decodeStream();
+        return;
+    }
+
+    m_readBuffer.append(m_socket->readAll());
+
+    QByteArray frame;
+    while (m_readBuffer.nextFrame(&frame)) {
+        emit dataReceived(frame);
+    }
+
+    if (m_readBuffer.hasError()) {
+        // 帧长度异常时无法重新同步, 断开连接 (开启自动重连时会重连)
+        qWarning() << "Invalid frame received, aborting connection";
+        m_readBuffer.clear();
+        m_socket->abort();
+    }
+}
+
+void TcpClient::decodeStream() {
+    // 套接字缓冲区中已有的数据全部交给解码器, 已取出的记录随即释放
+    m_streamDecoder.append(m_socket->readAll());
+
+    QVariant record;
+    while (m_streamDecoder.nextRecord(&record)) {
+        emit recordReceived(record);
+    }
+
+    if (m_streamDecoder.hasError()) {
+        qWarning() << "Invalid stream data received, aborting connection:"
+                   << m_streamDecoder.errorString();
+        m_streamDecoder.clear();
+        m_socket->abort();
+    }
 }
 
 void TcpClient::onError(QAbstractSocket::SocketError socketError) {
@@ -90,11 +278,31 @@ void TcpClient::onReconnectTimer() {
     m_socket->connectToHost(m_host, m_port);
 }
 
-void TcpClient::sendHeartbeat() { sendData("HEARTBEAT"); }
+void TcpClient::sendHeartbeat() {
+    // 心跳只对当前连接有意义, 断线时不排队
+    if (!isConnected()) {
+        ++m_sendQueueStats.skippedHeartbeats;
+        return;
+    }
+    sendData("HEARTBEAT");
+}
 
 void TcpClient::processQueue() {
+    qsizetype keep = m_sendQueue.size();
+    if (m_replayPolicy == ReplayNone) {
+        keep = 0;
+    } else if (m_replayPolicy == ReplayLatest) {
+        keep = qMin<qsizetype>(keep, m_replayLatestCount);
+    }
+    while (m_sendQueue.size() > keep) {
+        m_sendQueueStats.queuedBytes -= m_sendQueue.dequeue().size();
+        ++m_sendQueueStats.discardedOnReconnect;
+    }
+
     while (!m_sendQueue.isEmpty()) {
-        QByteArray data = m_sendQueue.dequeue();
-        m_socket->write(data);
+        const QueuedFrame frame = m_sendQueue.dequeue();
+        m_sendQueueStats.queuedBytes -= frame.size();
+        submitFrame(frame);
     }
+    flush();
 }
\ No newline at end of file
@@ -6,26 +6,72 @@
 #include <QTimer>
 #include <QtNetwork/QTcpSocket>
 
+#include "FrameBuffer.h"
+#include "StreamDecoder.h"
+
 class TcpClient : public QObject {
     Q_OBJECT
 
 public:
+    // 小块写入先在缓冲区中合并, 每轮事件循环或超过阈值时一次写出
+    enum WriteMode {
+        LowLatency,  // 开启 TCP_NODELAY, 合并阈值较小 (默认)
+        Throughput   // 保留 Nagle 算法, 合并阈值较大
+    };
+
+    // 断线期间排队的帧在重连后如何处理
+    enum ReplayPolicy {
+        ReplayAll,     // 全部按顺序发出 (默认)
+        ReplayLatest,  // 只发出最新的 N 帧
+        ReplayNone     // 全部丢弃
+    };
+
+    struct SendQueueStats {
+        int queuedFrames = 0;
+        qint64 queuedBytes = 0;
+        qint64 limitBytes = 0;
+        quint64 droppedFrames = 0;  // 超出容量被丢弃 (最旧的先丢)
+        qint64 droppedBytes = 0;
+        quint64 discardedOnReconnect = 0;  // 按重连策略丢弃
+        quint64 skippedHeartbeats = 0;     // 断线时跳过, 心跳从不排队
+    };
+
     explicit TcpClient(QObject *parent = nullptr);
     ~TcpClient();
 
     void connectToHost(const QString &host, quint16 port);
     void disconnectFromHost();
     void sendData(const QByteArray &data);
+    // header 与 payload 组成一帧, payload 以隐式共享方式交给套接字, 不拷贝
+    void sendFrame(const QByteArray &header, const QByteArray &payload);
 
     bool isConnected() const;
     void setAutoReconnect(bool enable);
     void setReconnectInterval(int msecs);
     void setHeartbeatInterval(int msecs);
+    // 分帧模式: 启用后 sendData 自动加帧, dataReceived 每次只发出一个完整帧
+    void setFramingMode(FrameBuffer::Mode mode);
+    FrameBuffer::Mode framingMode() const;
+    void setWriteMode(WriteMode mode);
+    WriteMode writeMode() const;
+    // 立即写出合并缓冲区中的数据
+    void flush();
+    // 断线时排队数据的字节上限, 超出时丢弃最旧的帧; <= 0 表示不限
+    void setSendQueueLimit(qint64 maxBytes);
+    void setReplayPolicy(ReplayPolicy policy, int latestCount = 0);
+    SendQueueStats sendQueueStats() const;
+    // 流式解码: 接收数据不分帧, 作为连续的 JSON 值或 CBOR 序列增量解析,
+    // 每条完整记录发出一次 recordReceived, 此时不再发出 dataReceived
+    void setStreamDecoding(bool enable,
+                           StreamDecoder::Format format = StreamDecoder::Json,
+                           bool splitTopLevelArrays = true);
 
 signals:
     void connected();
     void disconnected();
     void dataReceived(const QByteArray &data);
+    void recordReceived(const QVariant &record);
+    void bytesWritten(qint64 bytes);
     void error(QAbstractSocket::SocketError socketError);
 
 private slots:
@@ -43,9 +89,37 @@ private:
     bool m_autoReconnect;
     QTimer m_reconnectTimer;
     QTimer m_heartbeatTimer;
-    QQueue<QByteArray> m_sendQueue;
+    FrameBuffer m_readBuffer;
+    bool m_streamDecoding;
+    StreamDecoder m_streamDecoder;
+
+    // 排队以整帧为单位, 丢弃时不会破坏分帧
+    struct QueuedFrame {
+        QByteArray head;     // 完整帧, 或 sendFrame 的长度前缀与帧头
+        QByteArray payload;  // sendFrame 的负载, 隐式共享
+        bool newline = false;
+        qsizetype size() const {
+            return head.size() + payload.size() + (newline ? 1 : 0);
+        }
+    };
+    QQueue<QueuedFrame> m_sendQueue;
+    qint64 m_sendQueueLimit;
+    ReplayPolicy m_replayPolicy;
+    int m_replayLatestCount;
+    SendQueueStats m_sendQueueStats;
+
+    WriteMode m_writeMode;
+    QByteArray m_pendingWrite;  // 已连接时待合并写出的小块数据
+    QTimer m_flushTimer;        // 0ms 单次, 本轮事件循环处理完后写出
 
     void processQueue();
+    void decodeStream();
+    void submitFrame(const QueuedFrame &frame);
+    void enqueueFrame(const QueuedFrame &frame);
+    void dropOldestFrame();
+    void writeChunk(const QByteArray &data);
+    void applyWriteMode();
+    int coalesceThreshold() const;
 };
 
 #endif  // TCPCLIENT_H
\ No newline at end of file
@@ -1,14 +1,46 @@
 #include "WebSocket.h"
 #include <QDebug>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QtEndian>
+#include <algorithm>
+
+namespace {
+// 压缩帧头: magic(1) flags(1) 字典版本(1), 其后为 raw deflate 数据.
+// magic 区别于 MessageBus 的二进制帧 (0x01)、JSON ('{') 和 CBOR map
+constexpr char kCompressedMagic = 0x02;
+constexpr char kCompressedFlagText = 0x01;
+constexpr int kCompressedHeaderSize = 3;
+
+// 每轮事件循环最多写出的消息数, 余下的留到下一轮, 避免饿死接收
+constexpr int kDrainBatchSize = 256;
+
+// 有入站数据时最多连续跳过的心跳次数
+constexpr int kMaxSkippedHeartbeats = 4;
+}  // namespace
 
 WebSocketClient::WebSocketClient(QObject *parent)
     : QObject(parent),
-      m_webSocket(new QWebSocket),
+      m_webSocket(new QWebSocket(QString(), QWebSocketProtocol::VersionLatest,
+                                 this)),
       m_isConnected(false),
+      m_reconnectTimer(this),
       m_initialReconnectInterval(1000),
       m_maxReconnectInterval(30000),
+      m_reconnectBackoff(0),
+      m_heartbeatTimer(this),
+      m_drainScheduled(false),
       m_sslVerificationEnabled(true),
-      m_logLevel(Info) {
+      m_logLevel(Info),
+      m_compressionEnabled(false),
+      m_compressionMinSize(256),
+      m_peerCompression(false),
+      m_binaryFirst(false),
+      m_lastReceivedNs(0),
+      m_skippedHeartbeats(0),
+      m_deadLinkTimer(this),
+      m_deadRttMultiple(4.0),
+      m_minDeadTimeout(2000) {
     connect(m_webSocket, &QWebSocket::connected, this,
             &WebSocketClient::onConnected);
     connect(m_webSocket, &QWebSocket::disconnected, this,
@@ -17,11 +49,14 @@ WebSocketClient::WebSocketClient(QObject *parent)
             &WebSocketClient::onTextMessageReceived);
     connect(m_webSocket, &QWebSocket::binaryMessageReceived, this,
             &WebSocketClient::onBinaryMessageReceived);
+    connect(m_webSocket, &QWebSocket::bytesWritten, this,
+            &WebSocketClient::bytesWritten);
     connect(m_webSocket,
             QOverload<QAbstractSocket::SocketError>::of(&QWebSocket::error),
             this, &WebSocketClient::onError);
     connect(m_webSocket, &QWebSocket::sslErrors, this,
             &WebSocketClient::onSslErrors);
+    connect(m_webSocket, &QWebSocket::pong, this, &WebSocketClient::onPong);
 
     m_reconnectTimer.setSingleShot(true);
     connect(&m_reconnectTimer, &QTimer::timeout, this,
@@ -29,6 +64,12 @@ WebSocketClient::WebSocketClient(QObject *parent)
 
     connect(&m_heartbeatTimer, &QTimer::timeout, this,
             &WebSocketClient::sendHeartbeat);
+
+    m_clock.start();
+    m_rttWindow.reserve(RttWindowSize);
+    m_deadLinkTimer.setSingleShot(true);
+    connect(&m_deadLinkTimer, &QTimer::timeout, this,
+            &WebSocketClient::onDeadLinkTimeout);
 }
 
 WebSocketClient::~WebSocketClient() {
@@ -38,14 +79,16 @@ WebSocketClient::~WebSocketClient() {
 
 void WebSocketClient::connectToServer(const QUrl &url,
                                       const QMap<QString, QString> &headers) {
-    QMutexLocker locker(&m_mutex);
-    m_serverUrl = url;
-    m_customHeaders = headers;
+    QNetworkRequest request(url);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_serverUrl = url;
+        m_customHeaders = headers;
+    }
+    // open() 可能同步触发 error/disconnected, 不能在持锁时调用
     if (m_webSocket) {
         log(Debug, QString("Connecting to: %1").arg(url.toString()));
-        QNetworkRequest request(url);
-        for (auto it = m_customHeaders.constBegin();
-             it != m_customHeaders.constEnd(); ++it) {
+        for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
             request.setRawHeader(it.key().toUtf8(), it.value().toUtf8());
         }
         m_webSocket->open(request);
@@ -53,29 +96,116 @@ void WebSocketClient::connectToServer(const QUrl &url,
 }
 
 void WebSocketClient::sendTextMessage(const QString &message) {
-    QMutexLocker locker(&m_mutex);
+    submit(true, message.toUtf8());
+}
+
+void WebSocketClient::sendTextData(const QByteArray &utf8) {
+    submit(true, utf8);
+}
+
+void WebSocketClient::sendBinaryMessage(const QByteArray &message) {
+    submit(false, message);
+}
+
+void WebSocketClient::submit(bool text, const QByteArray &data) {
+    // socket 线程本身就是消费者, 没有积压时直接写出, 省一次事件循环
+    if (QThread::currentThread() == thread() && m_sendQueue.isEmpty()) {
+        WireStats delta;
+        sendOrQueue(qMakePair(text, data), &delta);
+        addWireStats(delta);
+        return;
+    }
+
+    m_sendQueue.push(qMakePair(text, data));
+    // 已有待执行的 drain 时不再投递, 一批消息只唤醒一次
+    if (!m_drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &WebSocketClient::drainSendQueue,
+                                  Qt::QueuedConnection);
+    }
+}
+
+void WebSocketClient::drainSendQueue() {
+    // 先清标志再取: 此后提交的消息会重新投递 drain, 不会遗漏
+    m_drainScheduled.exchange(false, std::memory_order_acq_rel);
+
+    WireStats delta;
+    OutboundFrame frame;
+    int count = 0;
+    while (count < kDrainBatchSize && m_sendQueue.tryPop(&frame)) {
+        sendOrQueue(frame, &delta);
+        ++count;
+    }
+    addWireStats(delta);
+
+    if (count == kDrainBatchSize &&
+        !m_drainScheduled.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &WebSocketClient::drainSendQueue,
+                                  Qt::QueuedConnection);
+    }
+}
+
+void WebSocketClient::sendOrQueue(const OutboundFrame &frame,
+                                  WireStats *stats) {
     if (m_isConnected) {
-        m_webSocket->sendTextMessage(message);
-        log(Debug, "Sent text message");
+        writeFrame(frame.second, frame.first, stats);
     } else {
-        log(Warning, "Cannot send text message. Not connected.");
-        m_messageQueue.enqueue(qMakePair(true, message.toUtf8()));
+        log(Warning, frame.first
+                         ? "Cannot send text message. Not connected."
+                         : "Cannot send binary message. Not connected.");
+        m_messageQueue.enqueue(frame);
     }
 }
 
-void WebSocketClient::sendBinaryMessage(const QByteArray &message) {
-    QMutexLocker locker(&m_mutex);
-    if (m_isConnected) {
-        m_webSocket->sendBinaryMessage(message);
-        log(Debug, "Sent binary message");
+void WebSocketClient::writeFrame(const QByteArray &data, bool text,
+                                 WireStats *stats) {
+    ++stats->messagesSent;
+    stats->payloadBytesSent += data.size();
+
+    if (m_compressionEnabled && m_peerCompression &&
+        data.size() >= m_compressionMinSize) {
+        QElapsedTimer timer;
+        timer.start();
+        const QByteArray compressed = m_compressor.compress(data);
+        stats->compressNanos += timer.nsecsElapsed();
+        if (!compressed.isEmpty() &&
+            compressed.size() + kCompressedHeaderSize < data.size()) {
+            QByteArray frame;
+            frame.reserve(kCompressedHeaderSize + compressed.size());
+            frame.append(kCompressedMagic);
+            frame.append(text ? kCompressedFlagText : char(0));
+            frame.append(static_cast<char>(DeflateCodec::DictionaryVersion));
+            frame.append(compressed);
+            stats->wireBytesSent += m_webSocket->sendBinaryMessage(frame);
+            ++stats->compressedMessagesSent;
+            log(Debug, "Sent compressed message");
+            return;
+        }
+    }
+
+    if (text && !m_binaryFirst) {
+        stats->wireBytesSent +=
+            m_webSocket->sendTextMessage(QString::fromUtf8(data));
+        log(Debug, "Sent text message");
     } else {
-        log(Warning, "Cannot send binary message. Not connected.");
-        m_messageQueue.enqueue(qMakePair(false, message));
+        stats->wireBytesSent += m_webSocket->sendBinaryMessage(data);
+        log(Debug, "Sent binary message");
     }
 }
 
-void WebSocketClient::closeConnection() {
+void WebSocketClient::addWireStats(const WireStats &delta) {
+    if (delta.messagesSent == 0) {
+        return;
+    }
     QMutexLocker locker(&m_mutex);
+    m_wireStats.messagesSent += delta.messagesSent;
+    m_wireStats.compressedMessagesSent += delta.compressedMessagesSent;
+    m_wireStats.payloadBytesSent += delta.payloadBytesSent;
+    m_wireStats.wireBytesSent += delta.wireBytesSent;
+    m_wireStats.compressNanos += delta.compressNanos;
+}
+
+void WebSocketClient::closeConnection() {
+    // close() 会同步触发 disconnected, 不持锁
     if (m_webSocket) {
         m_webSocket->close();
     }
@@ -115,18 +245,72 @@ void WebSocketClient::setSslConfiguration(const QSslConfiguration &config) {
     applySslConfiguration();
 }
 
-void WebSocketClient::onConnected() {
+void WebSocketClient::setCompressionEnabled(bool enable, int minSize) {
+    m_compressionMinSize = qMax(0, minSize);
+    m_compressionEnabled = enable;
+}
+
+void WebSocketClient::setPeerCompression(bool supported) {
+    m_peerCompression = supported;
+}
+
+bool WebSocketClient::isCompressing() const {
+    return m_compressionEnabled && m_peerCompression;
+}
+
+void WebSocketClient::setBinaryFirst(bool enable) { m_binaryFirst = enable; }
+
+WebSocketClient::WireStats WebSocketClient::wireStats() const {
+    QMutexLocker locker(&m_mutex);
+    return m_wireStats;
+}
+
+void WebSocketClient::setDeadLinkDetection(double rttMultiple,
+                                           int minTimeoutMsecs) {
+    QMutexLocker locker(&m_mutex);
+    m_deadRttMultiple = rttMultiple;
+    m_minDeadTimeout = qMax(0, minTimeoutMsecs);
+}
+
+WebSocketClient::LatencyStats WebSocketClient::latencyStats() const {
     QMutexLocker locker(&m_mutex);
+    LatencyStats stats = m_latency;
+    QVector<qint64> window = m_rttWindow;
+    locker.unlock();
+
+    if (window.isEmpty()) {
+        return stats;
+    }
+    std::sort(window.begin(), window.end());
+    const auto percentile = [&window](int p) {
+        return window.at((window.size() - 1) * p / 100);
+    };
+    stats.p50Usecs = percentile(50);
+    stats.p95Usecs = percentile(95);
+    stats.p99Usecs = percentile(99);
+    stats.maxUsecs = window.last();
+    return stats;
+}
+
+// 连接状态只在 socket 线程修改; 这里不持锁, 槽函数可以直接回调发送接口
+void WebSocketClient::onConnected() {
     m_isConnected = true;
+    m_reconnectTimer.stop();
+    m_reconnectBackoff = 0;
+    m_lastReceivedNs = m_clock.nsecsElapsed();
+    m_skippedHeartbeats = 0;
     log(Info, "Connected to server");
-    emit connected();
+    // 先补发积压的消息再通知上层: connected 槽中的发送会直接写出,
+    // 若先发信号就会插到积压消息前面
     processMessageQueue();
-    m_reconnectTimer.stop();
+    emit connected();
 }
 
 void WebSocketClient::onDisconnected() {
-    QMutexLocker locker(&m_mutex);
     m_isConnected = false;
+    // 重连后的对端需要重新协商
+    m_peerCompression = false;
+    m_deadLinkTimer.stop();
     log(Info, "Disconnected from server");
     emit disconnected();
     scheduleReconnect();
@@ -134,13 +318,63 @@ void WebSocketClient::onDisconnected() {
 
 void WebSocketClient::onTextMessageReceived(const QString &message) {
     log(Debug, QString("Received text message: %1").arg(message));
+    noteReceived();
+    {
+        // 文本按字符数计, 避免仅为统计再做一次 UTF-8 编码
+        QMutexLocker locker(&m_mutex);
+        ++m_wireStats.messagesReceived;
+        m_wireStats.payloadBytesReceived += message.size();
+        m_wireStats.wireBytesReceived += message.size();
+    }
     emit textMessageReceived(message);
 }
 
 void WebSocketClient::onBinaryMessageReceived(const QByteArray &message) {
     log(Debug, QString("Received binary message of size %1 bytes")
                    .arg(message.size()));
-    emit binaryMessageReceived(message);
+    noteReceived();
+
+    const bool compressed = m_compressionEnabled &&
+                            message.size() > kCompressedHeaderSize &&
+                            message.at(0) == kCompressedMagic;
+    if (!compressed) {
+        QMutexLocker locker(&m_mutex);
+        ++m_wireStats.messagesReceived;
+        m_wireStats.payloadBytesReceived += message.size();
+        m_wireStats.wireBytesReceived += message.size();
+        locker.unlock();
+        emit binaryMessageReceived(message);
+        return;
+    }
+
+    if (static_cast<quint8>(message.at(2)) != DeflateCodec::DictionaryVersion) {
+        log(Warning, "Dropped compressed message with unknown dictionary");
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray payload;
+    if (!m_decompressor.decompress(message.sliced(kCompressedHeaderSize),
+                                   &payload)) {
+        log(Warning, "Dropped compressed message that failed to inflate");
+        return;
+    }
+    const bool text = (message.at(1) & kCompressedFlagText) != 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_wireStats.messagesReceived;
+        ++m_wireStats.compressedMessagesReceived;
+        m_wireStats.payloadBytesReceived += payload.size();
+        m_wireStats.wireBytesReceived += message.size();
+        m_wireStats.decompressNanos += timer.nsecsElapsed();
+    }
+
+    if (text && !m_binaryFirst) {
+        emit textMessageReceived(QString::fromUtf8(payload));
+    } else {
+        emit binaryMessageReceived(payload);
+    }
 }
 
 void WebSocketClient::onError(QAbstractSocket::SocketError error) {
@@ -166,29 +400,153 @@ void WebSocketClient::onReconnectTimer() {
     connectToServer(m_serverUrl, m_customHeaders);
 }
 
-void WebSocketClient::sendHeartbeat() { sendTextMessage("PING"); }
+void WebSocketClient::sendHeartbeat() {
+    if (!m_isConnected) {
+        return;
+    }
 
-void WebSocketClient::processMessageQueue() {
-    while (!m_messageQueue.isEmpty()) {
-        auto message = m_messageQueue.dequeue();
-        if (message.first) {
-            sendTextMessage(QString::fromUtf8(message.second));
+    // 一个周期内收到过数据说明链路仍通, ping 只会浪费带宽
+    const qint64 now = m_clock.nsecsElapsed();
+    const qint64 interval = m_heartbeatTimer.interval() * qint64(1000000);
+    if (now - m_lastReceivedNs < interval &&
+        m_skippedHeartbeats < kMaxSkippedHeartbeats) {
+        ++m_skippedHeartbeats;
+        QMutexLocker locker(&m_mutex);
+        ++m_latency.pingsSkipped;
+        return;
+    }
+    m_skippedHeartbeats = 0;
+
+    // 负载携带发送时刻, pong 原样带回, 不依赖 Qt 毫秒精度的 elapsedTime
+    QByteArray payload(sizeof(qint64), Qt::Uninitialized);
+    qToBigEndian<qint64>(now, payload.data());
+    m_webSocket->ping(payload);
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_latency.pingsSent;
+    }
+
+    const int timeout = deadLinkTimeout();
+    if (timeout > 0 && !m_deadLinkTimer.isActive()) {
+        m_deadLinkTimer.start(timeout);
+    }
+}
+
+void WebSocketClient::onPong(quint64 elapsedTime, const QByteArray &payload) {
+    Q_UNUSED(elapsedTime)
+    noteReceived();
+    if (payload.size() != sizeof(qint64)) {
+        return;  // 不是本端心跳发出的 ping
+    }
+    const qint64 sent = qFromBigEndian<qint64>(payload.constData());
+    const qint64 elapsed = m_clock.nsecsElapsed() - sent;
+    if (sent < 0 || elapsed < 0) {
+        return;
+    }
+    recordRtt(elapsed / 1000);
+}
+
+void WebSocketClient::onDeadLinkTimeout() {
+    const qint64 silent = (m_clock.nsecsElapsed() - m_lastReceivedNs) / 1000000;
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_latency.deadLinks;
+    }
+    log(Warning,
+        QString("No response for %1 ms, dropping connection").arg(silent));
+    emit deadLinkDetected(silent);
+    // abort 会触发 disconnected, 由重连流程接手
+    m_webSocket->abort();
+}
+
+void WebSocketClient::noteReceived() {
+    m_lastReceivedNs = m_clock.nsecsElapsed();
+    m_deadLinkTimer.stop();
+}
+
+void WebSocketClient::recordRtt(qint64 usecs) {
+    {
+        QMutexLocker locker(&m_mutex);
+        // 与 TCP 的 SRTT/RTTVAR 相同的平滑方式 (RFC 6298)
+        if (m_latency.samples == 0) {
+            m_latency.smoothedUsecs = usecs;
+            m_latency.variationUsecs = usecs / 2;
         } else {
-            sendBinaryMessage(message.second);
+            m_latency.variationUsecs =
+                (3 * m_latency.variationUsecs +
+                 qAbs(m_latency.smoothedUsecs - usecs)) /
+                4;
+            m_latency.smoothedUsecs =
+                (7 * m_latency.smoothedUsecs + usecs) / 8;
         }
+        m_latency.lastUsecs = usecs;
+        if (m_rttWindow.size() < RttWindowSize) {
+            m_rttWindow.append(usecs);
+        } else {
+            m_rttWindow[static_cast<int>(m_latency.samples % RttWindowSize)] =
+                usecs;
+        }
+        ++m_latency.samples;
     }
+    log(Debug, QString("Heartbeat RTT: %1 us").arg(usecs));
+    emit rttMeasured(usecs);
+}
+
+int WebSocketClient::deadLinkTimeout() const {
+    QMutexLocker locker(&m_mutex);
+    if (m_deadRttMultiple <= 0) {
+        return 0;
+    }
+    // 尚无样本时无从估计, 至少等一个心跳周期
+    if (m_latency.samples == 0) {
+        return qMax(m_minDeadTimeout, m_heartbeatTimer.interval());
+    }
+    const qint64 timeout =
+        qRound64(m_latency.smoothedUsecs * m_deadRttMultiple / 1000);
+    return static_cast<int>(
+        qBound<qint64>(m_minDeadTimeout, timeout, 24 * 3600 * 1000));
+}
+
+void WebSocketClient::processMessageQueue() {
+    // 先补发离线暂存的消息, 再处理断线期间之后提交的消息, 保持提交顺序
+    WireStats delta;
+    while (m_isConnected && !m_messageQueue.isEmpty()) {
+        const OutboundFrame frame = m_messageQueue.dequeue();
+        writeFrame(frame.second, frame.first, &delta);
+    }
+    addWireStats(delta);
+    drainSendQueue();
 }
 
 void WebSocketClient::scheduleReconnect() {
-    if (!m_reconnectTimer.isActive()) {
-        static int currentInterval = m_initialReconnectInterval;
-        m_reconnectTimer.start(currentInterval);
-        currentInterval = qMin(currentInterval * 2, m_maxReconnectInterval);
+    if (m_reconnectTimer.isActive()) {
+        return;
+    }
+
+    int base = 0;
+    int cap = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        base = qMax(1, m_initialReconnectInterval);
+        cap = qMax(base, m_maxReconnectInterval);
     }
+    // 首次失败按上次等待为 base 计算, 第一轮重连也是分散的
+    const int previous = m_reconnectBackoff > 0 ? m_reconnectBackoff : base;
+    const int upper =
+        static_cast<int>(qMin<qint64>(cap, qint64(previous) * 3));
+    m_reconnectBackoff =
+        upper > base ? QRandomGenerator::global()->bounded(base, upper + 1)
+                     : base;
+
+    log(Debug, QString("Reconnecting in %1 ms").arg(m_reconnectBackoff));
+    m_reconnectTimer.start(m_reconnectBackoff);
+    emit reconnectScheduled(m_reconnectBackoff);
 }
 
 void WebSocketClient::clearMessageQueue() {
-    QMutexLocker locker(&m_mutex);
+    OutboundFrame frame;
+    while (m_sendQueue.tryPop(&frame)) {
+    }
     m_messageQueue.clear();
 }
 
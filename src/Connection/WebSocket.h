@@ -1,6 +1,7 @@
 #ifndef WEBSOCKETCLIENT_H
 #define WEBSOCKETCLIENT_H
 
+#include <QElapsedTimer>
 #include <QMap>
 #include <QMutex>
 #include <QObject>
@@ -8,8 +9,12 @@
 #include <QSslConfiguration>
 #include <QTimer>
 #include <QUrl>
+#include <QVector>
 #include <QtWebSockets/QWebSocket>
+#include <atomic>
 
+#include "DeflateCodec.h"
+#include "Utils/MpscQueue.h"
 
 class WebSocketClient : public QObject {
     Q_OBJECT
@@ -17,30 +22,92 @@ class WebSocketClient : public QObject {
 public:
     enum LogLevel { Debug, Info, Warning, Error };
 
+    // 负载字节统计: payload 为压缩前, wire 为实际写入 WebSocket 帧的负载
+    struct WireStats {
+        quint64 messagesSent = 0;
+        quint64 compressedMessagesSent = 0;
+        quint64 payloadBytesSent = 0;
+        quint64 wireBytesSent = 0;
+        qint64 compressNanos = 0;
+        quint64 messagesReceived = 0;
+        quint64 compressedMessagesReceived = 0;
+        quint64 payloadBytesReceived = 0;
+        quint64 wireBytesReceived = 0;
+        qint64 decompressNanos = 0;
+    };
+
+    // 心跳测得的往返时延, 单位微秒. 百分位取最近 RttWindowSize 个样本
+    struct LatencyStats {
+        quint64 samples = 0;
+        qint64 lastUsecs = 0;
+        qint64 smoothedUsecs = 0;   // EWMA, 新样本权重 1/8
+        qint64 variationUsecs = 0;  // 平均偏差, 新样本权重 1/4
+        qint64 p50Usecs = 0;
+        qint64 p95Usecs = 0;
+        qint64 p99Usecs = 0;
+        qint64 maxUsecs = 0;
+        quint64 pingsSent = 0;
+        quint64 pingsSkipped = 0;  // 有入站数据而省去的心跳
+        quint64 deadLinks = 0;
+    };
+
+    static constexpr int RttWindowSize = 256;
+
     explicit WebSocketClient(QObject *parent = nullptr);
     ~WebSocketClient();
 
     void connectToServer(
         const QUrl &url,
         const QMap<QString, QString> &headers = QMap<QString, QString>());
+    // 发送接口可在任意线程调用, 不加锁: 消息进入无锁提交队列,
+    // 由 socket 所在线程批量写出; 在 socket 线程且无积压时直接写出.
+    // 未连接时消息暂存, 连接后按提交顺序补发
     void sendTextMessage(const QString &message);
+    // 已编码为 UTF-8 的文本, 不经过 QString 转换
+    void sendTextData(const QByteArray &utf8);
     void sendBinaryMessage(const QByteArray &message);
     void closeConnection();
     bool isConnected() const;
 
     // New methods
+    // 重连等待采用 decorrelated jitter: 每次在 [initial, 上次 * 3] 内随机,
+    // 不超过 max; 连接成功后重置. 各实例独立随机, 不会同时重连
     void setReconnectInterval(int initialMsecs, int maxMsecs);
+    // 以 WebSocket ping 控制帧做心跳, pong 回来时记录 RTT.
+    // 一个周期内收到过任何数据时跳过本次 ping, 但最多连续跳过几次,
+    // 以保证 RTT 样本不会过期
     void setHeartbeatInterval(int msecs);
+    // ping 发出后超过 rttMultiple 倍平滑 RTT (至少 minTimeoutMsecs)
+    // 仍无任何入站数据时判定链路已死, 中断连接并走重连流程.
+    // rttMultiple <= 0 时关闭检测
+    void setDeadLinkDetection(double rttMultiple, int minTimeoutMsecs = 2000);
+    LatencyStats latencyStats() const;
     void enableSslCertificateVerification(bool enable);
     void setLogLevel(LogLevel level);
     void setSslConfiguration(const QSslConfiguration &config);
 
+    // Qt WebSockets 不支持 permessage-deflate, 在应用层压缩:
+    // 压缩后的消息以二进制帧发送, 首字节为 0x02, 随后是原始类型和字典版本.
+    // enable 后即可解压收到的压缩帧; 只有对端通过 setPeerCompression
+    // 确认支持后才会压缩发送, 小于 minSize 或压缩无收益的消息原样发送
+    void setCompressionEnabled(bool enable, int minSize = 256);
+    void setPeerCompression(bool supported);
+    bool isCompressing() const;
+    // 文本消息以二进制帧发送 UTF-8, 收到的文本以二进制形式交给上层,
+    // 省去 UTF-8 与 UTF-16 之间的转换; 要求对端能处理二进制帧中的文本
+    void setBinaryFirst(bool enable);
+    WireStats wireStats() const;
+
 signals:
     void connected();
     void disconnected();
     void textMessageReceived(const QString &message);
     void binaryMessageReceived(const QByteArray &message);
+    void bytesWritten(qint64 bytes);
     void errorOccurred(const QString &errorString);
+    void rttMeasured(qint64 usecs);
+    void deadLinkDetected(qint64 silentMsecs);
+    void reconnectScheduled(int msecs);  // 本次选定的重连等待
     void logMessage(LogLevel level, const QString &message);
 
 private slots:
@@ -55,10 +122,15 @@ private slots:
     void onReconnectTimer();
     void sendHeartbeat();
     void processMessageQueue();
+    void drainSendQueue();
+    void onPong(quint64 elapsedTime, const QByteArray &payload);
+    void onDeadLinkTimeout();
 
 private:
+    using OutboundFrame = QPair<bool, QByteArray>;  // (是否文本, 负载)
+
     QWebSocket *m_webSocket;
-    bool m_isConnected;
+    std::atomic<bool> m_isConnected;
     QUrl m_serverUrl;
     QMap<QString, QString> m_customHeaders;
 
@@ -66,17 +138,45 @@ private:
     QTimer m_reconnectTimer;
     int m_initialReconnectInterval;
     int m_maxReconnectInterval;
+    int m_reconnectBackoff;  // 上一次的重连等待, 0 表示连接成功后尚未失败
     QTimer m_heartbeatTimer;
-    QQueue<QPair<bool, QByteArray>> m_messageQueue;
+    QQueue<OutboundFrame> m_messageQueue;  // 离线暂存, 只在 socket 线程访问
+    MpscQueue<OutboundFrame> m_sendQueue;
+    std::atomic<bool> m_drainScheduled;
     bool m_sslVerificationEnabled;
     LogLevel m_logLevel;
-    QMutex m_mutex;
+    // 只保护配置和统计, 持有期间不操作 socket 也不发信号
+    mutable QMutex m_mutex;
     QSslConfiguration m_sslConfig;
+    std::atomic<bool> m_compressionEnabled;
+    std::atomic<int> m_compressionMinSize;
+    std::atomic<bool> m_peerCompression;
+    std::atomic<bool> m_binaryFirst;
+    DeflateCodec m_compressor;    // 只在 socket 线程使用
+    DeflateCodec m_decompressor;  // 只在 socket 线程使用
+    WireStats m_wireStats;
+
+    // 心跳状态只在 socket 线程访问; 配置和统计由 m_mutex 保护
+    QElapsedTimer m_clock;
+    qint64 m_lastReceivedNs;
+    int m_skippedHeartbeats;
+    QTimer m_deadLinkTimer;
+    double m_deadRttMultiple;
+    int m_minDeadTimeout;
+    LatencyStats m_latency;
+    QVector<qint64> m_rttWindow;  // 环形缓冲, 按 samples 取模写入
 
     void scheduleReconnect();
     void clearMessageQueue();
     void log(LogLevel level, const QString &message);
     void applySslConfiguration();
+    void submit(bool text, const QByteArray &data);
+    void sendOrQueue(const OutboundFrame &frame, WireStats *stats);
+    void writeFrame(const QByteArray &data, bool text, WireStats *stats);
+    void addWireStats(const WireStats &delta);
+    void noteReceived();
+    void recordRtt(qint64 usecs);
+    int deadLinkTimeout() const;
 };
 
 #endif  // WEBSOCKETCLIENT_H
\ No newline at end of file
@@ -0,0 +1,505 @@
+#include "FilterExpression.h"
+
+#include <QVarLengthArray>
+
+// 递归下降语法分析, 边分析边生成字节码
+class FilterExpression::Compiler {
+public:
+    Compiler(const QString &source, FilterExpression *program)
+        : m_source(source), m_program(program) {}
+
+    bool run() {
+        if (!parseOr()) {
+            return false;
+        }
+        skipSpace();
+        if (!atEnd()) {
+            return fail("unexpected input");
+        }
+        return true;
+    }
+
+    QString error() const { return m_error; }
+
+private:
+    const QString &m_source;
+    FilterExpression *m_program;
+    int m_pos = 0;
+    QString m_error;
+
+    bool atEnd() const { return m_pos >= m_source.size(); }
+    QChar current() const { return atEnd() ? QChar() : m_source.at(m_pos); }
+
+    bool fail(const QString &message) {
+        m_error = QString("%1 at position %2").arg(message).arg(m_pos);
+        return false;
+    }
+
+    void skipSpace() {
+        while (!atEnd() && m_source.at(m_pos).isSpace()) {
+            ++m_pos;
+        }
+    }
+
+    bool consume(QLatin1String token) {
+        skipSpace();
+        if (QStringView(m_source).sliced(m_pos).startsWith(token)) {
+            m_pos += token.size();
+            return true;
+        }
+        return false;
+    }
+
+    int emitOp(OpCode op, int operand = 0, CompareOp compare = Equal) {
+        Instruction instruction;
+        instruction.op = op;
+        instruction.operand = operand;
+        instruction.compare = compare;
+        m_program->m_code.append(instruction);
+        return m_program->m_code.size() - 1;
+    }
+
+    void emitConstant(const Value &value) {
+        m_program->m_constants.append(value);
+        emitOp(PushConst, m_program->m_constants.size() - 1);
+    }
+
+    int addPath(const QStringList &path) {
+        m_program->m_paths.append(path);
+        return m_program->m_paths.size() - 1;
+    }
+
+    bool parseOr() {
+        if (!parseAnd()) {
+            return false;
+        }
+        while (consume(QLatin1String("||"))) {
+            const int jump = emitOp(JumpIfTrueOrPop);
+            if (!parseAnd()) {
+                return false;
+            }
+            m_program->m_code[jump].operand = m_program->m_code.size();
+        }
+        return true;
+    }
+
+    bool parseAnd() {
+        if (!parseUnary()) {
+            return false;
+        }
+        while (consume(QLatin1String("&&"))) {
+            const int jump = emitOp(JumpIfFalseOrPop);
+            if (!parseUnary()) {
+                return false;
+            }
+            m_program->m_code[jump].operand = m_program->m_code.size();
+        }
+        return true;
+    }
+
+    bool parseUnary() {
+        skipSpace();
+        if (current() == '!' &&
+            !(m_pos + 1 < m_source.size() && m_source.at(m_pos + 1) == '=')) {
+            ++m_pos;
+            if (!parseUnary()) {
+                return false;
+            }
+            emitOp(Not);
+            return true;
+        }
+        return parseComparison();
+    }
+
+    bool parseComparison() {
+        if (!parseOperand()) {
+            return false;
+        }
+
+        static const struct {
+            const char *text;
+            CompareOp op;
+        } kOperators[] = {{"==", Equal},     {"!=", NotEqual},
+                          {"<=", LessEqual}, {">=", GreaterEqual},
+                          {"<", Less},       {">", Greater}};
+        for (const auto &candidate : kOperators) {
+            if (consume(QLatin1String(candidate.text))) {
+                if (!parseOperand()) {
+                    return false;
+                }
+                emitOp(Compare, 0, candidate.op);
+                return true;
+            }
+        }
+        return true;
+    }
+
+    bool parseOperand() {
+        skipSpace();
+        if (atEnd()) {
+            return fail("expected operand");
+        }
+
+        const QChar c = current();
+        if (c == '(') {
+            ++m_pos;
+            if (!parseOr()) {
+                return false;
+            }
+            return consume(QLatin1String(")")) || fail("expected ')'");
+        }
+        if (c == '"' || c == '\'') {
+            return parseString();
+        }
+        if (c.isDigit() || c == '-' || c == '.') {
+            Value value;
+            value.type = Value::Number;
+            if (!readNumber(&value.number)) {
+                return false;
+            }
+            emitConstant(value);
+            return true;
+        }
+        if (c == '$') {
+            ++m_pos;
+            emitOp(LoadField, addPath(QStringList()));
+            return true;
+        }
+        if (c.isLetter() || c == '_') {
+            return parseIdentifier();
+        }
+        return fail("unexpected character");
+    }
+
+    bool readNumber(double *number) {
+        skipSpace();
+        const int start = m_pos;
+        if (current() == '-') {
+            ++m_pos;
+        }
+        while (!atEnd()) {
+            const QChar c = current();
+            if (c.isDigit() || c == '.') {
+                ++m_pos;
+            } else if (c == 'e' || c == 'E') {
+                ++m_pos;
+                if (current() == '+' || current() == '-') {
+                    ++m_pos;
+                }
+            } else {
+                break;
+            }
+        }
+
+        bool ok = false;
+        *number =
+            QStringView(m_source).sliced(start, m_pos - start).toDouble(&ok);
+        if (!ok) {
+            m_pos = start;
+            return fail("invalid number");
+        }
+        return true;
+    }
+
+    bool parseString() {
+        const QChar quote = current();
+        ++m_pos;
+        Value value;
+        value.type = Value::String;
+        while (!atEnd() && current() != quote) {
+            QChar c = current();
+            ++m_pos;
+            if (c == '\\' && !atEnd()) {
+                c = current();
+                ++m_pos;
+                if (c == 'n') {
+                    c = '\n';
+                } else if (c == 't') {
+                    c = '\t';
+                }
+            }
+            value.string.append(c);
+        }
+        if (atEnd()) {
+            return fail("unterminated string");
+        }
+        ++m_pos;
+        emitConstant(value);
+        return true;
+    }
+
+    QString readIdentifier() {
+        skipSpace();
+        const int start = m_pos;
+        while (!atEnd() && (current().isLetterOrNumber() || current() == '_' ||
+                            current() == '.')) {
+            ++m_pos;
+        }
+        return m_source.mid(start, m_pos - start);
+    }
+
+    bool readPath(QStringList *path) {
+        skipSpace();
+        if (current() == '$') {
+            ++m_pos;
+            path->clear();
+            return true;
+        }
+        const QString text = readIdentifier();
+        *path = text.split('.');
+        for (const QString &segment : *path) {
+            if (segment.isEmpty()) {
+                return fail("invalid field name");
+            }
+        }
+        return true;
+    }
+
+    bool parseIdentifier() {
+        const int start = m_pos;
+        const QString text = readIdentifier();
+        if (text == "true" || text == "false") {
+            emitConstant(fromBool(text == "true"));
+            return true;
+        }
+        if (text == "null") {
+            emitConstant(Value());
+            return true;
+        }
+
+        skipSpace();
+        if (current() != '(') {
+            m_pos = start;
+            QStringList path;
+            if (!readPath(&path)) {
+                return false;
+            }
+            emitOp(LoadField, addPath(path));
+            return true;
+        }
+
+        ++m_pos;
+        if (text == "exists") {
+            QStringList path;
+            if (!readPath(&path)) {
+                return false;
+            }
+            emitOp(FieldExists, addPath(path));
+        } else if (text == "rate") {
+            RateBucket bucket;
+            if (!readNumber(&bucket.ratePerSecond)) {
+                return false;
+            }
+            bucket.burst = qMax(1.0, bucket.ratePerSecond);
+            if (consume(QLatin1String(",")) && !readNumber(&bucket.burst)) {
+                return false;
+            }
+            if (bucket.ratePerSecond <= 0.0 || bucket.burst < 1.0) {
+                return fail("invalid rate");
+            }
+            bucket.tokens = bucket.burst;
+            m_program->m_buckets.append(bucket);
+            emitOp(RateLimit, m_program->m_buckets.size() - 1);
+        } else {
+            m_pos = start;
+            return fail(QString("unknown function '%1'").arg(text));
+        }
+        return consume(QLatin1String(")")) || fail("expected ')'");
+    }
+};
+
+bool FilterExpression::compile(const QString &source) {
+    m_source = source;
+    m_error.clear();
+    m_code.clear();
+    m_constants.clear();
+    m_paths.clear();
+    m_buckets.clear();
+    m_clock.start();
+
+    Compiler compiler(source, this);
+    if (!compiler.run()) {
+        m_error = compiler.error();
+        m_code.clear();
+        return false;
+    }
+    return true;
+}
+
+bool FilterExpression::matches(const QVariant &data) {
+    if (m_code.isEmpty()) {
+        return true;
+    }
+
+    QVarLengthArray<Value, 8> stack;
+    const int size = m_code.size();
+    for (int pc = 0; pc < size; ++pc) {
+        const Instruction &instruction = m_code.at(pc);
+        switch (instruction.op) {
+            case PushConst:
+                stack.append(m_constants.at(instruction.operand));
+                break;
+            case LoadField: {
+                const QVariant *field =
+                    lookup(data, m_paths.at(instruction.operand));
+                stack.append(field ? toValue(*field) : Value());
+                break;
+            }
+            case FieldExists:
+                stack.append(fromBool(
+                    lookup(data, m_paths.at(instruction.operand)) != nullptr));
+                break;
+            case RateLimit:
+                stack.append(
+                    fromBool(takeToken(m_buckets[instruction.operand])));
+                break;
+            case Compare: {
+                const Value rhs = stack.takeLast();
+                stack.last() = fromBool(
+                    compareValues(stack.last(), rhs, instruction.compare));
+                break;
+            }
+            case Not:
+                stack.last() = fromBool(!isTruthy(stack.last()));
+                break;
+            case JumpIfFalseOrPop:
+                if (!isTruthy(stack.last())) {
+                    pc = instruction.operand - 1;
+                } else {
+                    stack.removeLast();
+                }
+                break;
+            case JumpIfTrueOrPop:
+                if (isTruthy(stack.last())) {
+                    pc = instruction.operand - 1;
+                } else {
+                    stack.removeLast();
+                }
+                break;
+        }
+    }
+    return !stack.isEmpty() && isTruthy(stack.last());
+}
+
+const QVariant *FilterExpression::lookup(const QVariant &data,
+                                         const QStringList &path) {
+    // 直接访问 QVariant 内部的容器, 避免 toMap() 的拷贝
+    const QVariant *current = &data;
+    for (const QString &key : path) {
+        const int type = current->metaType().id();
+        if (type == QMetaType::QVariantMap) {
+            const auto *map =
+                static_cast<const QVariantMap *>(current->constData());
+            const auto it = map->constFind(key);
+            if (it == map->constEnd()) {
+                return nullptr;
+            }
+            current = &it.value();
+        } else if (type == QMetaType::QVariantHash) {
+            const auto *hash =
+                static_cast<const QVariantHash *>(current->constData());
+            const auto it = hash->constFind(key);
+            if (it == hash->constEnd()) {
+                return nullptr;
+            }
+            current = &it.value();
+        } else {
+            return nullptr;
+        }
+    }
+    return current;
+}
+
+FilterExpression::Value FilterExpression::toValue(const QVariant &variant) {
+    Value value;
+    switch (variant.metaType().id()) {
+        case QMetaType::Bool:
+            value = fromBool(variant.toBool());
+            break;
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Short:
+        case QMetaType::UShort:
+        case QMetaType::Float:
+        case QMetaType::Double:
+            value.type = Value::Number;
+            value.number = variant.toDouble();
+            break;
+        case QMetaType::QString:
+            value.type = Value::String;
+            value.string = variant.toString();
+            break;
+        default:
+            break;
+    }
+    return value;
+}
+
+FilterExpression::Value FilterExpression::fromBool(bool value) {
+    Value result;
+    result.type = Value::Bool;
+    result.number = value ? 1.0 : 0.0;
+    return result;
+}
+
+bool FilterExpression::isTruthy(const Value &value) {
+    switch (value.type) {
+        case Value::Null:
+            return false;
+        case Value::Bool:
+        case Value::Number:
+            return value.number != 0.0;
+        case Value::String:
+            return !value.string.isEmpty();
+    }
+    return false;
+}
+
+bool FilterExpression::compareValues(const Value &lhs, const Value &rhs,
+                                     CompareOp op) {
+    if (lhs.type != rhs.type) {
+        return op == NotEqual;
+    }
+
+    int order = 0;
+    if (lhs.type == Value::String) {
+        order = QString::compare(lhs.string, rhs.string);
+    } else if (lhs.number < rhs.number) {
+        order = -1;
+    } else if (lhs.number > rhs.number) {
+        order = 1;
+    } else if (lhs.number != rhs.number) {
+        return op == NotEqual;  // NaN
+    }
+
+    switch (op) {
+        case Equal:
+            return order == 0;
+        case NotEqual:
+            return order != 0;
+        case Less:
+            return order < 0;
+        case LessEqual:
+            return order <= 0;
+        case Greater:
+            return order > 0;
+        case GreaterEqual:
+            return order >= 0;
+    }
+    return false;
+}
+
+bool FilterExpression::takeToken(RateBucket &bucket) {
+    const qint64 now = m_clock.nsecsElapsed();
+    bucket.tokens =
+        qMin(bucket.burst, bucket.tokens + (now - bucket.lastRefillNs) *
+                                               bucket.ratePerSecond / 1e9);
+    bucket.lastRefillNs = now;
+    if (bucket.tokens < 1.0) {
+        return false;
+    }
+    bucket.tokens -= 1.0;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef FILTEREXPRESSION_H
+#define FILTEREXPRESSION_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+// 消息过滤表达式, 编译一次为扁平字节码, 求值时直接在解码得到的
+// QVariantMap/QVariantHash 中按路径查找字段, 不构造中间容器.
+//
+// 语法:
+//   字段      status, camera.temp (按 '.' 逐层查找), $ 表示整个负载
+//   字面量    12, -3.5, "ok", 'ok', true, false, null
+//   比较      == != < <= > >=   (数字按数值, 字符串按字典序比较,
+//                                类型不同时只有 != 成立)
+//   逻辑      && || ! ( )       (短路求值)
+//   函数      exists(field)     字段是否存在
+//             rate(n[, burst])  令牌桶限速, 每秒最多放行 n 条
+// 例: "temp > -20 && status == \"ok\" && rate(5)"
+//
+// rate() 带有状态, 同一个实例不应跨线程使用
+class FilterExpression {
+public:
+    FilterExpression() = default;
+
+    // 失败时返回 false, 错误信息见 errorString(), 原有程序被清空
+    bool compile(const QString &source);
+    bool isValid() const { return !m_code.isEmpty(); }
+    QString source() const { return m_source; }
+    QString errorString() const { return m_error; }
+
+    // 未成功编译的表达式放行所有消息
+    bool matches(const QVariant &data);
+
+private:
+    class Compiler;
+
+    struct Value {
+        enum Type : quint8 { Null, Bool, Number, String };
+        Type type = Null;
+        double number = 0.0;  // Bool 时为 0/1
+        QString string;
+    };
+
+    enum OpCode : quint8 {
+        PushConst,         // operand: 常量下标
+        LoadField,         // operand: 路径下标
+        FieldExists,       // operand: 路径下标
+        RateLimit,         // operand: 令牌桶下标
+        Compare,           // compare: 比较运算符
+        Not,
+        JumpIfFalseOrPop,  // 栈顶为假时跳转并保留, 否则弹出
+        JumpIfTrueOrPop
+    };
+
+    enum CompareOp : quint8 {
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual
+    };
+
+    struct Instruction {
+        OpCode op = PushConst;
+        CompareOp compare = Equal;
+        int operand = 0;
+    };
+
+    struct RateBucket {
+        double ratePerSecond = 0.0;
+        double burst = 0.0;
+        double tokens = 0.0;
+        qint64 lastRefillNs = 0;
+    };
+
+    QString m_source;
+    QString m_error;
+    QVector<Instruction> m_code;
+    QVector<Value> m_constants;
+    QVector<QStringList> m_paths;  // 空路径表示整个负载
+    QVector<RateBucket> m_buckets;
+    QElapsedTimer m_clock;
+
+    static const QVariant *lookup(const QVariant &data,
+                                  const QStringList &path);
+    static Value toValue(const QVariant &variant);
+    static Value fromBool(bool value);
+    static bool isTruthy(const Value &value);
+    static bool compareValues(const Value &lhs, const Value &rhs,
+                              CompareOp op);
+    bool takeToken(RateBucket &bucket);
+};
+
+#endif  // FILTEREXPRESSION_H
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "LatencyHistogram.h"
+
+#include <QtAlgorithms>
+#include <limits>
+
+LatencyHistogram::LatencyHistogram() { reset(); }
+
+void LatencyHistogram::record(qint64 nanos) {
+    if (nanos < 0) {
+        nanos = 0;
+    }
+
+    ++m_buckets[bucketIndex(nanos)];
+    ++m_count;
+    m_sum += static_cast<double>(nanos);
+    m_min = qMin(m_min, nanos);
+    m_max = qMax(m_max, nanos);
+}
+
+void LatencyHistogram::reset() {
+    m_buckets.fill(0);
+    m_count = 0;
+    m_min = std::numeric_limits<qint64>::max();
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+double LatencyHistogram::meanNanos() const {
+    return m_count ? m_sum / static_cast<double>(m_count) : 0.0;
+}
+
+qint64 LatencyHistogram::percentileNanos(double percentile) const {
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const double target =
+        qBound(0.0, percentile, 100.0) / 100.0 * static_cast<double>(m_count);
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += m_buckets[i];
+        if (seen > 0 && static_cast<double>(seen) >= target) {
+            return qMin(bucketUpperBoundNanos(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+int LatencyHistogram::bucketIndex(qint64 nanos) {
+    const quint64 value = static_cast<quint64>(qMax<qint64>(0, nanos));
+    if (value < SubBucketCount) {
+        return static_cast<int>(value);
+    }
+
+    // 第 group 组覆盖 [2^(group+SubBucketBits-1), 2^(group+SubBucketBits)),
+    // 组内子桶宽度为 2^(group-1)
+    const int magnitude = 63 - qCountLeadingZeroBits(value);
+    if (magnitude > MaxMagnitude) {
+        return BucketCount - 1;
+    }
+    const int shift = magnitude - SubBucketBits;
+    const int group = shift + 1;
+    const int sub = static_cast<int>(value >> shift) & (SubBucketCount - 1);
+    return group * SubBucketCount + sub;
+}
+
+qint64 LatencyHistogram::bucketUpperBoundNanos(int index) {
+    const int group = index / SubBucketCount;
+    const qint64 sub = index % SubBucketCount;
+    if (group == 0) {
+        return sub + 1;
+    }
+    return (SubBucketCount + sub + 1) << (group - 1);
+}
+
+QString LatencyHistogram::toString() const {
+    return QString("count=%1 min=%2us mean=%3us p50=%4us p99=%5us max=%6us")
+        .arg(m_count)
+        .arg(minNanos() / 1000.0, 0, 'f', 1)
+        .arg(meanNanos() / 1000.0, 0, 'f', 1)
+        .arg(percentileNanos(50) / 1000.0, 0, 'f', 1)
+        .arg(percentileNanos(99) / 1000.0, 0, 'f', 1)
+        .arg(m_max / 1000.0, 0, 'f', 1);
+}
\ No newline at end of file
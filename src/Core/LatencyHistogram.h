@@ -0,0 +1,47 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QtGlobal>
+#include <array>
+
+// HDR 风格的对数-线性延迟直方图 (单位: 纳秒)
+// 每个 2 的幂次区间再线性划分为 SubBucketCount 个子桶, 相对误差不超过
+// 1/SubBucketCount (约 3%); 记录只需几次位运算, 无分配
+// 超过 2^MaxMagnitude ns (约 18 分钟) 的样本计入最后一个桶
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 5;
+    static constexpr int SubBucketCount = 1 << SubBucketBits;
+    static constexpr int MaxMagnitude = 40;
+    static constexpr int BucketCount =
+        (MaxMagnitude - SubBucketBits + 2) * SubBucketCount;
+
+    LatencyHistogram();
+
+    void record(qint64 nanos);
+    void reset();
+
+    quint64 count() const { return m_count; }
+    qint64 minNanos() const { return m_count ? m_min : 0; }
+    qint64 maxNanos() const { return m_max; }
+    double meanNanos() const;
+
+    // 返回给定百分位 (0-100) 所在桶的上界 (纳秒), 不超过最大值
+    qint64 percentileNanos(double percentile) const;
+
+    quint64 bucketValue(int index) const { return m_buckets[index]; }
+    static qint64 bucketUpperBoundNanos(int index);
+    static int bucketIndex(qint64 nanos);
+
+    QString toString() const;
+
+private:
+    std::array<quint64, BucketCount> m_buckets;
+    quint64 m_count;
+    qint64 m_min;
+    qint64 m_max;
+    double m_sum;
+};
+
+#endif  // LATENCYHISTOGRAM_H
\ No newline at end of file
@@ -1,64 +1,148 @@
 #include "MessageBus.h"
+#include "MessageBusIoWorker.h"
+#include "MessageTrace.h"
+#include <QCborMap>
+#include <QCborValue>
+#include <QDebug>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QUuid>
-#include <QtSql/QSqlQuery>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QtEndian>
+#include <atomic>
 
+namespace {
+// 握手控制频道, 用于协商线路编码, 不会分发给订阅者
+const QString kHelloChannel = QStringLiteral("$bus/hello");
+// 确认控制频道, data 为被确认消息 ID 的字符串形式
+const QString kAckChannel = QStringLiteral("$bus/ack");
+
+// CBOR 编码使用整数键以减小体积
+enum CborKey : qint64 {
+    CborChannel = 0,
+    CborData = 1,
+    CborPriority = 2,
+    CborMessageId = 3,
+    CborRequiresAck = 4
+};
+
+// 二进制帧头: magic(1) flags(1) priority(1) 保留(1) messageId(8, 大端)
+// 频道长度(2, 大端) 频道(UTF-8), 其后为负载.
+// magic 区别于 JSON 的 '{' 和 CBOR map 的 0xA0-0xBF
+constexpr uchar kBinaryFrameMagic = 0x01;
+constexpr int kBinaryHeaderFixedSize = 14;
+constexpr uchar kBinaryFlagRequiresAck = 0x01;
+
+// 对端或数据库提供的优先级, 越界值会在 queueStatsKey 中与其他协议冲突
+MessageBus::Priority clampPriority(qint64 priority) {
+    return static_cast<MessageBus::Priority>(
+        qBound<qint64>(MessageBus::Low, priority, MessageBus::Critical));
+}
+}  // namespace
 
 MessageBus::MessageBus(QObject *parent)
     : QObject(parent),
       m_webSocketClient(new WebSocketClient(this)),
       m_tcpClient(new TcpClient(this)),
       m_httpRequestCenter(new HttpRequestCenter(this)),
-      m_persistenceEnabled(false) {
-    connect(m_webSocketClient, &WebSocketClient::connected, this,
-            &MessageBus::onWebSocketConnected);
-    connect(m_webSocketClient, &WebSocketClient::disconnected, this,
-            &MessageBus::onWebSocketDisconnected);
-    // connect(m_webSocketClient, &WebSocketClient::error, this,
-    //         &MessageBus::onWebSocketError);
-    connect(m_webSocketClient, &WebSocketClient::textMessageReceived, this,
-            &MessageBus::onWebSocketMessageReceived);
+      m_inProcessEndpoint(new InProcessEndpoint(this)),
+      m_wildcardMatches(MaxWildcardCacheEntries),
+      m_nextProtocol(0),
+      m_coalescedCount(0),
+      m_ackWindow(256),
+      m_ackInitialTimeoutMs(1000),
+      m_ackMaxTimeoutMs(30000),
+      m_ackMaxAttempts(8),
+      m_smoothedRttMs(0.0),
+      m_rttVarianceMs(0.0),
+      m_dispatchMode(TimerDispatch),
+      m_batchMaxMessages(1),
+      m_batchMaxDelayUs(0),
+      m_pendingSinceFlush(0),
+      m_processingQueue(false),
+      m_metricsEnabled(true),
+      m_metricsOnlyChannels(0),
+      m_lastMetricsAt(0),
+      m_webSocketCompression(false),
+      m_peerSupportsCompression(false),
+      m_persistenceEnabled(false),
+      m_persistenceFlushInterval(50),
+      m_persistence(nullptr),
+      m_ioThread(nullptr),
+      m_ioWorker(nullptr),
+      m_recorder(nullptr) {
+    m_clock.start();
 
-    connect(m_tcpClient, &TcpClient::connected, this,
-            &MessageBus::onTcpConnected);
-    connect(m_tcpClient, &TcpClient::disconnected, this,
-            &MessageBus::onTcpDisconnected);
-    connect(m_tcpClient, &TcpClient::error, this, &MessageBus::onTcpError);
-    connect(m_tcpClient, &TcpClient::dataReceived, this,
-            &MessageBus::onTcpDataReceived);
+    // 每个 readyRead 不一定是完整消息, TCP 上必须分帧
+    m_tcpClient->setFramingMode(FrameBuffer::LengthPrefixed);
+    connectTransportSignals(true);
 
     connect(m_httpRequestCenter, &HttpRequestCenter::requestFinished, this,
             &MessageBus::onHttpRequestFinished);
     connect(m_httpRequestCenter, &HttpRequestCenter::requestError, this,
             &MessageBus::onHttpRequestError);
 
+    // 进程内传输本身无阻塞, 不交给 I/O 线程
+    connect(m_inProcessEndpoint, &InProcessEndpoint::connected, this,
+            &MessageBus::onInProcessConnected);
+    connect(m_inProcessEndpoint, &InProcessEndpoint::disconnected, this,
+            &MessageBus::onInProcessDisconnected);
+    connect(m_inProcessEndpoint, &InProcessEndpoint::readyRead, this,
+            &MessageBus::onInProcessReadyRead);
+    connect(m_inProcessEndpoint, &InProcessEndpoint::writable, this,
+            [this]() { onTransportBytesWritten(0); });
+
     m_queueProcessTimer.setInterval(100);  // Process queue every 100ms
     connect(&m_queueProcessTimer, &QTimer::timeout, this,
             &MessageBus::processMessageQueue);
     m_queueProcessTimer.start();
+
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_batchTimer, &QTimer::timeout, this,
+            &MessageBus::processMessageQueue);
+
+    // 只在有待确认消息时运行, 每个刻度推进一次时间轮
+    m_ackTimer.setInterval(static_cast<int>(m_ackWheel.tickMs()));
+    connect(&m_ackTimer, &QTimer::timeout, this,
+            &MessageBus::processAckTimeouts);
 }
 
 MessageBus::~MessageBus() {
-    if (m_persistenceEnabled) {
-        m_database.close();
+    shutdownIoThread(false);
+    stopRecording();
+    if (m_persistence) {
+        m_persistence->stop();
     }
 }
 
 void MessageBus::connectWebSocket(const QString &url) {
-    m_webSocketClient->connectToServer(QUrl(url));
+    WebSocketClient *client = m_webSocketClient;
+    runOnIoThread([client, url]() { client->connectToServer(QUrl(url)); });
 }
 
 void MessageBus::connectTcp(const QString &host, quint16 port) {
-    m_tcpClient->connectToHost(host, port);
+    TcpClient *client = m_tcpClient;
+    runOnIoThread(
+        [client, host, port]() { client->connectToHost(host, port); });
 }
 
 void MessageBus::configureHttp(const QString &baseUrl) {
     // Configure HTTP client base URL
 }
 
-void MessageBus::sendMessage(const QString &channel, const QVariant &message,
+void MessageBus::connectInProcess(MessageBus *first, MessageBus *second,
+                                  int capacity) {
+    InProcessEndpoint::connectPair(first->m_inProcessEndpoint,
+                                   second->m_inProcessEndpoint, capacity);
+}
+
+void MessageBus::disconnectInProcess() {
+    m_inProcessEndpoint->disconnectFromPeer();
+}
+
+bool MessageBus::sendMessage(const QString &channel, const QVariant &message,
                              Protocol protocol, Priority priority,
                              bool requiresAck) {
     Message msg;
@@ -69,22 +153,85 @@ void MessageBus::sendMessage(const QString &channel, const QVariant &message,
     msg.messageId = generateMessageId();
     msg.requiresAck = requiresAck;
 
-    enqueueMessage(msg);
+    return enqueueMessage(msg);
+}
+
+bool MessageBus::sendBinaryMessage(const QString &channel,
+                                   const QByteArray &payload,
+                                   Protocol protocol, Priority priority,
+                                   bool requiresAck) {
+    if (channel.toUtf8().size() > 0xFFFF) {
+        qWarning() << "MessageBus: channel name too long for binary frame";
+        return false;
+    }
+
+    Message msg;
+    msg.channel = channel;
+    msg.data = payload;  // QVariant 只持有隐式共享的引用
+    msg.protocol = protocol;
+    msg.priority = priority;
+    msg.messageId = generateMessageId();
+    msg.requiresAck = requiresAck;
+    msg.binary = true;
+
+    return enqueueMessage(msg);
 }
 
 void MessageBus::subscribe(const QString &channel, QObject *receiver,
                            const char *method) {
-    m_subscribers[channel].append(qMakePair(receiver, method));
+    if (!receiver || !method) {
+        return;
+    }
+
+    QByteArray signature(method);
+    if (!signature.contains('(')) {
+        signature += "(QVariant)";
+    }
+    const int index = receiver->metaObject()->indexOfMethod(
+        QMetaObject::normalizedSignature(signature.constData()).constData());
+    if (index < 0) {
+        qWarning() << "MessageBus: no method" << signature << "on"
+                   << receiver->metaObject()->className();
+        return;
+    }
+
+    Subscriber subscriber;
+    subscriber.receiver = receiver;
+    subscriber.method = method;
+    subscriber.metaMethod = receiver->metaObject()->method(index);
+    addSubscriber(channel, subscriber);
+}
+
+void MessageBus::subscribe(const QString &channel, QObject *context,
+                           std::function<void(const QVariant &)> callback) {
+    if (!context || !callback) {
+        return;
+    }
+
+    Subscriber subscriber;
+    subscriber.receiver = context;
+    subscriber.callback = std::move(callback);
+    addSubscriber(channel, subscriber);
 }
 
 void MessageBus::unsubscribe(const QString &channel, QObject *receiver,
                              const char *method) {
-    if (m_subscribers.contains(channel)) {
-        auto &list = m_subscribers[channel];
-        list.removeAll(qMakePair(receiver, method));
-        if (list.isEmpty()) {
-            m_subscribers.remove(channel);
+    auto matches = [&](const Subscriber &subscriber) {
+        return subscriber.receiver.isNull() ||
+               (subscriber.receiver == receiver &&
+                (!method || subscriber.method == method));
+    };
+
+    if (TopicTrie<Subscriber>::isWildcard(channel)) {
+        if (m_wildcardSubscribers.removeIf(channel, matches) > 0) {
+            m_wildcardMatches.clear();
         }
+        return;
+    }
+
+    const int id = m_channelIds.value(channel, -1);
+    if (id >= 0) {
+        m_channels[id].subscribers.removeIf(matches);
     }
 }
 
@@ -93,120 +240,674 @@ void MessageBus::setAutoReconnect(bool enable, Protocol protocol) {
         case WebSocket:
             // m_webSocketClient->setAutoReconnect(enable);
             break;
-        case TCP:
-            m_tcpClient->setAutoReconnect(enable);
+        case TCP: {
+            TcpClient *client = m_tcpClient;
+            runOnIoThread(
+                [client, enable]() { client->setAutoReconnect(enable); });
             break;
+        }
         case HTTP:
             // HTTP typically doesn't need persistent connections
+        case InProcess:
             break;
     }
 }
 
 void MessageBus::setPersistenceEnabled(bool enable) {
+    if (enable == m_persistenceEnabled) {
+        return;
+    }
     m_persistenceEnabled = enable;
+
     if (enable) {
-        m_database = QSqlDatabase::addDatabase("QSQLITE");
-        m_database.setDatabaseName("messagebus.db");
-        if (m_database.open()) {
-            QSqlQuery query;
-            query.exec(
-                "CREATE TABLE IF NOT EXISTS messages "
-                "(id TEXT PRIMARY KEY, channel TEXT, data BLOB, protocol "
-                "INTEGER, priority INTEGER, requires_ack INTEGER)");
-        }
-        loadPersistedMessages();
+        m_persistence = new MessagePersistence(this);
+        // 同步恢复: 之后入队的新消息必须排在已保存的消息之后
+        restorePersistedMessages(
+            m_persistence->start("messagebus.db", m_persistenceFlushInterval));
     } else {
-        m_database.close();
+        m_persistence->stop();
+        m_persistence->deleteLater();
+        m_persistence = nullptr;
     }
 }
 
+void MessageBus::setPersistenceFlushInterval(int msecs) {
+    // 下次启用持久化时生效
+    m_persistenceFlushInterval = qMax(1, msecs);
+}
+
+MessagePersistence::Stats MessageBus::persistenceStats() const {
+    return m_persistence ? m_persistence->stats() : MessagePersistence::Stats();
+}
+
 void MessageBus::setMessageFilter(
     const QString &channel, std::function<bool(const QVariant &)> filter) {
-    m_filters[channel] = filter;
+    m_channels[internChannel(channel)].filter = filter;
+}
+
+bool MessageBus::setMessageFilter(const QString &channel,
+                                  const QString &expression) {
+    FilterExpression filter;
+    if (!filter.compile(expression)) {
+        qWarning() << "MessageBus: invalid filter for" << channel << ":"
+                   << filter.errorString();
+        return false;
+    }
+    // rate() 的令牌桶状态随 lambda 保存
+    m_channels[internChannel(channel)].filter =
+        [filter](const QVariant &data) mutable {
+            return filter.matches(data);
+        };
+    return true;
 }
 
 void MessageBus::setRouteRule(const QString &sourceChannel,
                               const QString &targetChannel,
                               Protocol targetProtocol) {
-    m_routeRules[sourceChannel] = qMakePair(targetChannel, targetProtocol);
+    clearRouteRules(sourceChannel);
+    addRouteRule(sourceChannel, targetChannel, targetProtocol);
+}
+
+bool MessageBus::addRouteRule(const QString &sourceChannel,
+                              const QString &targetChannel,
+                              Protocol targetProtocol,
+                              const QString &condition) {
+    RouteTarget route;
+    route.channel = targetChannel;
+    route.protocol = targetProtocol;
+    if (!condition.isEmpty()) {
+        FilterExpression filter;
+        if (!filter.compile(condition)) {
+            qWarning() << "MessageBus: invalid route condition for"
+                       << sourceChannel << ":" << filter.errorString();
+            return false;
+        }
+        route.condition = [filter](const QVariant &data) mutable {
+            return filter.matches(data);
+        };
+    }
+    m_channels[internChannel(sourceChannel)].routes.append(route);
+    return true;
 }
 
-void MessageBus::acknowledgeMessage(const QString &messageId) {
+void MessageBus::clearRouteRules(const QString &sourceChannel) {
+    const int id = m_channelIds.value(sourceChannel, -1);
+    if (id >= 0) {
+        m_channels[id].routes.clear();
+    }
+}
+
+void MessageBus::acknowledgeMessage(MessageId messageId) {
     // Remove the message from the queue if it's still there
-    m_messageQueue.removeIf(
-        [messageId](const Message &msg) { return msg.messageId == messageId; });
+    // (只移除索引, 队列中的条目出队时被跳过)
+    auto it = m_queuedIndex.find(messageId);
+    if (it != m_queuedIndex.end()) {
+        const QueuedEntry entry = it.value();
+        m_queuedIndex.erase(it);
+        if (!entry.coalesceKey.isEmpty()) {
+            m_coalesced.remove(entry.coalesceKey);
+        }
+        adjustQueueDepth(entry.protocol, entry.priority, -1);
+    }
+
+    auto flight = m_inFlight.find(messageId);
+    if (flight != m_inFlight.end()) {
+        // Karn 算法: 重传过的消息无法确定确认对应哪次发送, 不采样 RTT
+        if (flight->attempts == 1) {
+            const qint64 rttNs = m_clock.nsecsElapsed() - flight->sentAtNs;
+            const double rttMs = rttNs / 1e6;
+            if (m_ackRtt.count() == 0) {
+                m_smoothedRttMs = rttMs;
+                m_rttVarianceMs = rttMs / 2;
+            } else {
+                m_rttVarianceMs = 0.75 * m_rttVarianceMs +
+                                  0.25 * qAbs(m_smoothedRttMs - rttMs);
+                m_smoothedRttMs = 0.875 * m_smoothedRttMs + 0.125 * rttMs;
+            }
+            m_ackRtt.record(rttNs);
+        }
+        m_inFlight.erase(flight);
+        ++m_ackStats.acknowledged;
+        if (m_inFlight.isEmpty()) {
+            m_ackTimer.stop();
+            m_ackWheel.clear();
+        }
+        // 窗口腾出空间后继续发送
+        if (m_dispatchMode == EventDispatch) {
+            processMessageQueue();
+        }
+    }
 
     // Remove the message from the database if persistence is enabled
     if (m_persistenceEnabled) {
-        QSqlQuery query;
-        query.prepare("DELETE FROM messages WHERE id = :id");
-        query.bindValue(":id", messageId);
-        query.exec();
+        m_persistence->remove(messageId);
     }
 
     emit messageAcknowledged(messageId);
 }
 
-void MessageBus::onWebSocketConnected() { emit connected(WebSocket); }
+void MessageBus::setAckWindow(int window) {
+    m_ackWindow = window;
+    if (m_dispatchMode == EventDispatch) {
+        processMessageQueue();
+    }
+}
+
+void MessageBus::setAckRetransmit(int initialTimeoutMs, int maxTimeoutMs,
+                                  int maxAttempts) {
+    m_ackInitialTimeoutMs = qMax(1, initialTimeoutMs);
+    m_ackMaxTimeoutMs = qMax(m_ackInitialTimeoutMs, maxTimeoutMs);
+    m_ackMaxAttempts = maxAttempts;
+}
+
+MessageBus::AckStats MessageBus::ackStats() const {
+    AckStats stats = m_ackStats;
+    stats.inFlight = static_cast<int>(m_inFlight.size());
+    stats.window = m_ackWindow;
+    stats.smoothedRttMs = m_smoothedRttMs;
+    stats.retransmitTimeoutMs = retransmitTimeoutMs(1);
+    return stats;
+}
+
+const LatencyHistogram &MessageBus::ackRttHistogram() const {
+    return m_ackRtt;
+}
+
+void MessageBus::setChannelCoalescing(const QString &channel, bool enable,
+                                      const QString &keyField) {
+    ChannelRecord &record = m_channels[internChannel(channel)];
+    record.coalesce = enable;
+    record.coalesceKeyField = keyField;
+}
+
+quint64 MessageBus::coalescedMessageCount() const { return m_coalescedCount; }
+
+void MessageBus::setQueueCapacity(Protocol protocol, Priority priority,
+                                  int capacity, OverflowPolicy policy) {
+    QueueStats &stats = m_queueStats[queueStatsKey(protocol, priority)];
+    stats.capacity = capacity;
+    stats.policy = policy;
+    adjustQueueDepth(protocol, priority, 0);
+}
+
+MessageBus::QueueStats MessageBus::queueStats(Protocol protocol,
+                                              Priority priority) const {
+    return m_queueStats.value(queueStatsKey(protocol, priority));
+}
+
+quint64 MessageBus::droppedMessageCount() const {
+    quint64 total = 0;
+    for (const QueueStats &stats : m_queueStats) {
+        total += stats.dropped + stats.rejected;
+    }
+    return total;
+}
+
+bool MessageBus::isBackpressured(Protocol protocol) const {
+    for (int priority = Low; priority <= Critical; ++priority) {
+        if (m_queueStats
+                .value(queueStatsKey(protocol, static_cast<Priority>(priority)))
+                .backpressure) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MessageBus::setDispatchMode(DispatchMode mode) {
+    m_dispatchMode = mode;
+    if (mode == EventDispatch) {
+        m_queueProcessTimer.stop();
+        processMessageQueue();
+    } else {
+        m_batchTimer.stop();
+        m_queueProcessTimer.start();
+    }
+}
+
+MessageBus::DispatchMode MessageBus::dispatchMode() const {
+    return m_dispatchMode;
+}
+
+void MessageBus::setMicroBatching(int maxMessages, int maxDelayUs) {
+    m_batchMaxMessages = qMax(1, maxMessages);
+    m_batchMaxDelayUs = qMax(0, maxDelayUs);
+}
+
+const LatencyHistogram &MessageBus::sendLatencyHistogram() const {
+    return m_sendLatency;
+}
+
+void MessageBus::resetSendLatencyHistogram() { m_sendLatency.reset(); }
+
+const QString MessageBus::OtherChannelsKey = QStringLiteral("$other");
+
+void MessageBus::setMetricsEnabled(bool enable) { m_metricsEnabled = enable; }
+
+bool MessageBus::isMetricsEnabled() const { return m_metricsEnabled; }
+
+QHash<QString, MessageBus::ChannelMetrics> MessageBus::channelMetrics() {
+    if (m_ioWorker) {
+        // 取回 I/O 线程统计的写出字节数
+        QHash<QString, quint64> written;
+        MessageBusIoWorker *worker = m_ioWorker;
+        QMetaObject::invokeMethod(
+            worker,
+            [worker, &written]() { written = worker->takeWrittenBytes(); },
+            Qt::BlockingQueuedConnection);
+        for (auto it = written.constBegin(); it != written.constEnd(); ++it) {
+            metricsFor(it.key()).sentBytes += it.value();
+        }
+    }
+
+    const qint64 now = m_clock.nsecsElapsed();
+    const double seconds =
+        m_lastMetricsAt > 0 ? (now - m_lastMetricsAt) / 1e9 : 0.0;
+    m_lastMetricsAt = now;
+
+    auto rate = [seconds](quint64 current, quint64 previous) {
+        return seconds > 0.0 ? (current - previous) / seconds : 0.0;
+    };
+
+    QHash<QString, ChannelMetrics> result;
+    auto snapshot = [&result, &rate](ChannelRecord &record) {
+        ChannelMetrics metrics = record.metrics;
+        if (metrics.sentMessages == 0 && metrics.receivedMessages == 0 &&
+            metrics.filterDrops == 0 && metrics.routeHits == 0) {
+            return;
+        }
+        const ChannelMetrics &previous = record.previous;
+        metrics.sentMessageRate =
+            rate(metrics.sentMessages, previous.sentMessages);
+        metrics.sentByteRate = rate(metrics.sentBytes, previous.sentBytes);
+        metrics.receivedMessageRate =
+            rate(metrics.receivedMessages, previous.receivedMessages);
+        metrics.receivedByteRate =
+            rate(metrics.receivedBytes, previous.receivedBytes);
+        record.previous = record.metrics;
+        result.insert(record.name, metrics);
+    };
+    for (ChannelRecord &record : m_channels) {
+        snapshot(record);
+    }
+    m_otherChannels.name = OtherChannelsKey;
+    snapshot(m_otherChannels);
+    return result;
+}
+
+const LatencyHistogram &MessageBus::dispatchLatencyHistogram() const {
+    return m_dispatchLatency;
+}
+
+void MessageBus::resetMetrics() {
+    for (ChannelRecord &record : m_channels) {
+        record.metrics = ChannelMetrics();
+        record.previous = ChannelMetrics();
+    }
+    m_otherChannels.metrics = ChannelMetrics();
+    m_otherChannels.previous = ChannelMetrics();
+    m_lastMetricsAt = 0;
+    m_dispatchLatency.reset();
+    m_sendLatency.reset();
+}
+
+bool MessageBus::startRecording(const QString &path) {
+    stopRecording();
+    auto *recorder = new MessageRecorder;
+    if (!recorder->open(path)) {
+        delete recorder;
+        return false;
+    }
+    m_recorder = recorder;
+    return true;
+}
+
+void MessageBus::stopRecording() {
+    delete m_recorder;
+    m_recorder = nullptr;
+}
+
+bool MessageBus::isRecording() const { return m_recorder != nullptr; }
+
+void MessageBus::setWireFormat(Protocol protocol, WireFormat format) {
+    m_wireFormats[protocol] = format;
+    if (format != Json && isTransportConnected(protocol)) {
+        sendHello(protocol);
+    }
+}
+
+void MessageBus::setChannelWireFormat(const QString &channel,
+                                      WireFormat format) {
+    m_channelWireFormats[channel] = format;
+    if (format == Json) {
+        return;
+    }
+    for (Protocol protocol : {WebSocket, TCP, InProcess}) {
+        if (isTransportConnected(protocol)) {
+            sendHello(protocol);
+        }
+    }
+}
+
+MessageBus::WireFormat MessageBus::negotiatedWireFormat(
+    Protocol protocol) const {
+    return m_wireFormats.value(protocol, Json) == Cbor &&
+                   m_peerSupportsCbor.value(protocol, false)
+               ? Cbor
+               : Json;
+}
+
+bool MessageBus::setTcpFramingMode(FrameBuffer::Mode mode) {
+    if (mode == FrameBuffer::NewlineDelimited) {
+        qWarning() << "MessageBus: newline framing cannot carry CBOR or"
+                   << "binary frames";
+        return false;
+    }
+    TcpClient *client = m_tcpClient;
+    runOnIoThread([client, mode]() { client->setFramingMode(mode); });
+    return true;
+}
+
+void MessageBus::setTcpWriteMode(TcpClient::WriteMode mode) {
+    TcpClient *client = m_tcpClient;
+    runOnIoThread([client, mode]() { client->setWriteMode(mode); });
+}
+
+void MessageBus::setWebSocketCompression(bool enable, int minSize) {
+    m_webSocketCompression = enable;
+    WebSocketClient *client = m_webSocketClient;
+    const bool peer = enable && m_peerSupportsCompression;
+    runOnIoThread([client, enable, minSize, peer]() {
+        client->setCompressionEnabled(enable, minSize);
+        client->setPeerCompression(peer);
+    });
+    // 重新握手让对端得知本端可以解压
+    if (enable && isTransportConnected(WebSocket)) {
+        m_helloSent.remove(WebSocket);
+        sendHello(WebSocket);
+    }
+}
+
+void MessageBus::setWebSocketBinaryFirst(bool enable) {
+    WebSocketClient *client = m_webSocketClient;
+    runOnIoThread([client, enable]() { client->setBinaryFirst(enable); });
+}
+
+void MessageBus::setWebSocketHeartbeat(int intervalMsecs,
+                                       double deadRttMultiple) {
+    WebSocketClient *client = m_webSocketClient;
+    runOnIoThread([client, intervalMsecs, deadRttMultiple]() {
+        client->setDeadLinkDetection(deadRttMultiple);
+        client->setHeartbeatInterval(intervalMsecs);
+    });
+}
+
+WebSocketClient::LatencyStats MessageBus::webSocketLatency() const {
+    return m_webSocketClient->latencyStats();
+}
+
+void MessageBus::setTcpSendQueueLimit(qint64 maxBytes) {
+    TcpClient *client = m_tcpClient;
+    runOnIoThread(
+        [client, maxBytes]() { client->setSendQueueLimit(maxBytes); });
+}
+
+void MessageBus::setTcpReplayPolicy(TcpClient::ReplayPolicy policy,
+                                    int latestCount) {
+    TcpClient *client = m_tcpClient;
+    runOnIoThread([client, policy, latestCount]() {
+        client->setReplayPolicy(policy, latestCount);
+    });
+}
+
+TcpClient::SendQueueStats MessageBus::tcpSendQueueStats() const {
+    if (!m_ioWorker) {
+        return m_tcpClient->sendQueueStats();
+    }
+    // TcpClient 的统计不加锁, 必须在其所在的 I/O 线程读取
+    TcpClient::SendQueueStats stats;
+    TcpClient *client = m_tcpClient;
+    QMetaObject::invokeMethod(
+        m_ioWorker, [client, &stats]() { stats = client->sendQueueStats(); },
+        Qt::BlockingQueuedConnection);
+    return stats;
+}
+
+void MessageBus::setIoThreadEnabled(bool enable) {
+    if (enable == isIoThreadEnabled()) {
+        return;
+    }
+
+    if (!enable) {
+        shutdownIoThread(true);
+        return;
+    }
+
+    // 断开后重新连接, 使 worker 的直接连接先于本对象的排队连接执行,
+    // 收到 connected 时 worker 中的连接状态已经更新
+    disconnect(m_webSocketClient, nullptr, this, nullptr);
+    disconnect(m_tcpClient, nullptr, this, nullptr);
+
+    m_ioWorker =
+        new MessageBusIoWorker(m_webSocketClient, m_tcpClient, m_clock);
+    m_webSocketClient->setParent(m_ioWorker);
+    m_tcpClient->setParent(m_ioWorker);
+    connectTransportSignals(false);
+    connect(m_ioWorker, &MessageBusIoWorker::inboundReady, this,
+            &MessageBus::drainInbound);
+    connect(m_ioWorker, &MessageBusIoWorker::outboundSpaceAvailable, this,
+            &MessageBus::processMessageQueue);
+    connect(m_ioWorker, &MessageBusIoWorker::writeFailed, this,
+            &MessageBus::onIoWriteFailed);
+
+    m_ioThread = new QThread(this);
+    m_ioThread->setObjectName("MessageBusIo");
+    m_ioWorker->moveToThread(m_ioThread);
+    m_ioThread->start();
+}
+
+bool MessageBus::isIoThreadEnabled() const { return m_ioWorker != nullptr; }
+
+void MessageBus::shutdownIoThread(bool deliverInbound) {
+    if (!m_ioWorker) {
+        return;
+    }
+
+    // 在 I/O 线程中发完剩余消息, 再把 worker 及传输对象移回本线程
+    MessageBusIoWorker *worker = m_ioWorker;
+    m_ioWorker = nullptr;
+    QThread *target = thread();
+    QMetaObject::invokeMethod(
+        worker,
+        [worker, target]() {
+            worker->drainOutbound();
+            worker->moveToThread(target);
+        },
+        Qt::BlockingQueuedConnection);
+    m_ioThread->quit();
+    m_ioThread->wait();
+    delete m_ioThread;
+    m_ioThread = nullptr;
+
+    disconnect(m_webSocketClient, nullptr, this, nullptr);
+    disconnect(m_tcpClient, nullptr, this, nullptr);
+    m_webSocketClient->setParent(this);
+    m_tcpClient->setParent(this);
+    connectTransportSignals(true);
+
+    const QList<Message> pending = worker->takeAllInbound();
+    const QList<Message> failed = worker->takeFailedWrites();
+    delete worker;
+    requeueFailedWrites(failed);
+    if (deliverInbound) {
+        for (const Message &message : pending) {
+            handleIncomingMessage(message);
+        }
+    }
+}
+
+void MessageBus::runOnIoThread(const std::function<void()> &task) {
+    if (m_ioWorker) {
+        QMetaObject::invokeMethod(m_ioWorker, task, Qt::QueuedConnection);
+    } else {
+        task();
+    }
+}
+
+void MessageBus::connectTransportSignals(bool receiveData) {
+    connect(m_webSocketClient, &WebSocketClient::connected, this,
+            &MessageBus::onWebSocketConnected);
+    connect(m_webSocketClient, &WebSocketClient::disconnected, this,
+            &MessageBus::onWebSocketDisconnected);
+    // connect(m_webSocketClient, &WebSocketClient::error, this,
+    //         &MessageBus::onWebSocketError);
+    connect(m_webSocketClient, &WebSocketClient::bytesWritten, this,
+            &MessageBus::onTransportBytesWritten);
+
+    connect(m_tcpClient, &TcpClient::connected, this,
+            &MessageBus::onTcpConnected);
+    connect(m_tcpClient, &TcpClient::disconnected, this,
+            &MessageBus::onTcpDisconnected);
+    connect(m_tcpClient, &TcpClient::error, this, &MessageBus::onTcpError);
+    connect(m_tcpClient, &TcpClient::bytesWritten, this,
+            &MessageBus::onTransportBytesWritten);
+
+    // 启用 I/O 线程时由 worker 接收并解码
+    if (receiveData) {
+        connect(m_webSocketClient, &WebSocketClient::textMessageReceived, this,
+                &MessageBus::onWebSocketMessageReceived);
+        connect(m_webSocketClient, &WebSocketClient::binaryMessageReceived,
+                this, &MessageBus::onWebSocketBinaryMessageReceived);
+        connect(m_tcpClient, &TcpClient::dataReceived, this,
+                &MessageBus::onTcpDataReceived);
+    }
+}
+
+void MessageBus::drainInbound() {
+    if (!m_ioWorker) {
+        return;
+    }
+
+    m_ioWorker->beginInboundDrain();
+    Message message;
+    // 分发过程中可能关闭 I/O 线程, 每次循环都重新检查
+    while (m_ioWorker && m_ioWorker->takeInbound(&message)) {
+        handleIncomingMessage(message);
+    }
+    if (m_ioWorker) {
+        m_ioWorker->requestInboundBacklogFlush();
+    }
+}
+
+void MessageBus::onIoWriteFailed() {
+    if (m_ioWorker) {
+        requeueFailedWrites(m_ioWorker->takeFailedWrites());
+    }
+}
+
+void MessageBus::requeueFailedWrites(const QList<Message> &messages) {
+    // submit 成功时已按发送处理 (出队并删除持久化记录), 这里恢复原状.
+    // 逆序放回各自队首, 保持原有发送顺序
+    bool requeued = false;
+    for (auto it = messages.crbegin(); it != messages.crend(); ++it) {
+        const Message &message = *it;
+        if (message.channel == kHelloChannel) {
+            m_helloSent.remove(message.protocol);  // 重连后重新握手
+            continue;
+        }
+        if (message.channel == kAckChannel) {
+            enqueueMessage(message, false);
+            continue;
+        }
+        if (m_inFlight.contains(message.messageId)) {
+            continue;  // 待确认消息由重传计时器负责重发
+        }
+
+        Message queued = message;
+        queued.coalesceKey.clear();
+        QueuedEntry entry;
+        entry.protocol = queued.protocol;
+        entry.priority = queued.priority;
+        m_queuedIndex.insert(queued.messageId, entry);
+        adjustQueueDepth(queued.protocol, queued.priority, 1);
+        m_sendQueues[queued.protocol].prepend(queued, queued.priority);
+        if (m_persistenceEnabled && !queued.requiresAck) {
+            persistMessage(queued);
+        }
+        requeued = true;
+    }
+    if (requeued) {
+        scheduleDispatch();
+    }
+}
+
+void MessageBus::onWebSocketConnected() {
+    emit connected(WebSocket);
+    sendHello(WebSocket);
+    processMessageQueue();
+}
 
-void MessageBus::onWebSocketDisconnected() { emit disconnected(WebSocket); }
+void MessageBus::onWebSocketDisconnected() {
+    m_peerSupportsCbor.remove(WebSocket);
+    m_peerSupportsCompression = false;
+    m_helloSent.remove(WebSocket);
+    emit disconnected(WebSocket);
+}
 
 void MessageBus::onWebSocketError(QAbstractSocket::SocketError error) {
     // emit this->error(WebSocket, m_webSocketClient->errorString());
 }
 
 void MessageBus::onWebSocketMessageReceived(const QString &message) {
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8());
-    if (doc.isObject()) {
-        QJsonObject obj = doc.object();
-        Message msg;
-        msg.channel = obj["channel"].toString();
-        msg.data = obj["data"].toVariant();
-        msg.protocol = WebSocket;
-        msg.priority = static_cast<Priority>(obj["priority"].toInt());
-        msg.messageId = obj["messageId"].toString();
-        msg.requiresAck = obj["requiresAck"].toBool();
-        distributeMessage(msg);
-    }
+    handleIncomingFrame(message.toUtf8(), WebSocket);
 }
 
-void MessageBus::onTcpConnected() { emit connected(TCP); }
+void MessageBus::onWebSocketBinaryMessageReceived(const QByteArray &message) {
+    handleIncomingFrame(message, WebSocket);
+}
+
+void MessageBus::onTcpConnected() {
+    emit connected(TCP);
+    sendHello(TCP);
+    processMessageQueue();
+}
 
-void MessageBus::onTcpDisconnected() { emit disconnected(TCP); }
+void MessageBus::onTcpDisconnected() {
+    m_peerSupportsCbor.remove(TCP);
+    m_helloSent.remove(TCP);
+    emit disconnected(TCP);
+}
 
 void MessageBus::onTcpError(QAbstractSocket::SocketError error) {
     // emit this->error(TCP, m_tcpClient->errorString());
 }
 
 void MessageBus::onTcpDataReceived(const QByteArray &data) {
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isObject()) {
-        QJsonObject obj = doc.object();
-        Message msg;
-        msg.channel = obj["channel"].toString();
-        msg.data = obj["data"].toVariant();
-        msg.protocol = TCP;
-        msg.priority = static_cast<Priority>(obj["priority"].toInt());
-        msg.messageId = obj["messageId"].toString();
-        msg.requiresAck = obj["requiresAck"].toBool();
-        distributeMessage(msg);
+    handleIncomingFrame(data, TCP);
+}
+
+void MessageBus::onInProcessConnected() {
+    emit connected(InProcess);
+    sendHello(InProcess);
+    processMessageQueue();
+}
+
+void MessageBus::onInProcessDisconnected() {
+    m_peerSupportsCbor.remove(InProcess);
+    m_helloSent.remove(InProcess);
+    emit disconnected(InProcess);
+}
+
+void MessageBus::onInProcessReadyRead() {
+    QByteArray frame;
+    while (m_inProcessEndpoint->takeFrame(&frame)) {
+        handleIncomingFrame(frame, InProcess);
     }
 }
 
 void MessageBus::onHttpRequestFinished(HttpRequest *request, int statusCode,
                                        const QByteArray &response) {
-    QJsonDocument doc = QJsonDocument::fromJson(response);
-    if (doc.isObject()) {
-        QJsonObject obj = doc.object();
-        Message msg;
-        msg.channel = obj["channel"].toString();
-        msg.data = obj["data"].toVariant();
-        msg.protocol = HTTP;
-        msg.priority = static_cast<Priority>(obj["priority"].toInt());
-        msg.messageId = obj["messageId"].toString();
-        msg.requiresAck = obj["requiresAck"].toBool();
-        distributeMessage(msg);
-    }
+    handleIncomingFrame(response, HTTP);
 }
 
 void MessageBus::onHttpRequestError(HttpRequest *request,
@@ -215,150 +916,860 @@ void MessageBus::onHttpRequestError(HttpRequest *request,
 }
 
 void MessageBus::distributeMessage(const Message &message) {
-    // Apply filter if exists
-    if (m_filters.contains(message.channel)) {
-        if (!m_filters[message.channel](message.data)) {
+    // 只查不建: 对端可以发送任意多个不同主题, 通配符匹配结果另行缓存
+    const int id = m_channelIds.value(message.channel, -1);
+
+    if (m_metricsEnabled) {
+        ChannelMetrics &metrics =
+            id >= 0 ? m_channels[id].metrics : metricsFor(message.channel);
+        ++metrics.receivedMessages;
+        metrics.receivedBytes += message.wireSize;
+    }
+
+    if (id >= 0) {
+        const ChannelRecord &record = m_channels.at(id);
+
+        // Apply filter if exists
+        if (record.filter && !record.filter(message.data)) {
+            if (m_metricsEnabled) {
+                ++m_channels[id].metrics.filterDrops;
+            }
             return;  // Message filtered out
         }
+
+        // Check for routing rules
+        if (!record.routes.isEmpty()) {
+            // 发送时可能新建频道记录使 record 失效, 先拷贝路由表
+            const QVector<RouteTarget> routes = record.routes;
+            int hits = 0;
+            for (const RouteTarget &route : routes) {
+                if (route.condition && !route.condition(message.data)) {
+                    continue;
+                }
+                ++hits;
+                if (message.binary) {
+                    sendBinaryMessage(route.channel,
+                                      message.data.toByteArray(),
+                                      route.protocol, message.priority,
+                                      message.requiresAck);
+                } else {
+                    sendMessage(route.channel, message.data, route.protocol,
+                                message.priority, message.requiresAck);
+                }
+            }
+            if (hits > 0) {
+                if (m_metricsEnabled) {
+                    m_channels[id].metrics.routeHits += hits;
+                }
+                return;
+            }
+        }
     }
 
-    // Check for routing rules
-    if (m_routeRules.contains(message.channel)) {
-        const auto &rule = m_routeRules[message.channel];
-        sendMessage(rule.first, message.data, rule.second, message.priority,
-                    message.requiresAck);
-        return;
+    if (m_metricsEnabled && message.enqueuedAt > 0) {
+        m_dispatchLatency.record(m_clock.nsecsElapsed() - message.enqueuedAt);
     }
 
     emit messageReceived(message.channel, message.data);
 
-    if (m_subscribers.contains(message.channel)) {
-        for (const auto &subscriber : m_subscribers[message.channel]) {
-            QMetaObject::invokeMethod(subscriber.first, subscriber.second,
-                                      Q_ARG(QVariant, message.data));
+    if (id >= 0) {
+        // 拷贝 (隐式共享) 一份, 回调中订阅/取消订阅不会影响本次遍历
+        const QVector<Subscriber> subscribers = m_channels.at(id).subscribers;
+        for (const Subscriber &subscriber : subscribers) {
+            invokeSubscriber(subscriber, message.data);
         }
     }
 
-    if (message.requiresAck) {
-        acknowledgeMessage(message.messageId);
+    if (!m_wildcardSubscribers.isEmpty()) {
+        const QVector<Subscriber> matched =
+            wildcardSubscribersFor(message.channel);
+        for (const Subscriber &subscriber : matched) {
+            invokeSubscriber(subscriber, message.data);
+        }
     }
 }
 
-void MessageBus::persistMessage(const Message &message) {
-    if (!m_persistenceEnabled)
+int MessageBus::internChannel(const QString &channel) {
+    auto it = m_channelIds.constFind(channel);
+    if (it != m_channelIds.constEnd()) {
+        return it.value();
+    }
+
+    const int id = m_channels.size();
+    ChannelRecord record;
+    record.name = channel;
+    m_channels.append(record);
+    m_channelIds.insert(channel, id);
+    return id;
+}
+
+MessageBus::ChannelMetrics &MessageBus::metricsFor(const QString &channel) {
+    // 对端可以发送任意多个不同主题, 仅为计数登记的频道数量必须有上限
+    const int id = m_channelIds.value(channel, -1);
+    if (id >= 0) {
+        return m_channels[id].metrics;
+    }
+    if (m_metricsOnlyChannels < MaxMetricsOnlyChannels) {
+        ++m_metricsOnlyChannels;
+        return m_channels[internChannel(channel)].metrics;
+    }
+    return m_otherChannels.metrics;
+}
+
+void MessageBus::addSubscriber(const QString &channel,
+                               const Subscriber &subscriber) {
+    if (!TopicTrie<Subscriber>::isWildcard(channel)) {
+        m_channels[internChannel(channel)].subscribers.append(subscriber);
+        return;
+    }
+
+    if (!TopicTrie<Subscriber>::isValidFilter(channel)) {
+        qWarning() << "MessageBus: invalid topic filter" << channel;
         return;
+    }
+    m_wildcardSubscribers.insert(channel, subscriber);
+    m_wildcardMatches.clear();
+}
+
+QVector<MessageBus::Subscriber> MessageBus::wildcardSubscribersFor(
+    const QString &topic) {
+    if (const QVector<Subscriber> *cached = m_wildcardMatches.object(topic)) {
+        return *cached;
+    }
+    // 缓存满时淘汰最久未用的主题, 订阅变化时整体清空
+    auto *matched = new QVector<Subscriber>;
+    m_wildcardSubscribers.match(topic, matched);
+    const QVector<Subscriber> result = *matched;
+    m_wildcardMatches.insert(topic, matched);
+    return result;
+}
+
+void MessageBus::invokeSubscriber(const Subscriber &subscriber,
+                                  const QVariant &data) {
+    QObject *receiver = subscriber.receiver.data();
+    if (!receiver) {
+        return;
+    }
+
+    if (!subscriber.callback) {
+        subscriber.metaMethod.invoke(receiver, Qt::AutoConnection,
+                                     Q_ARG(QVariant, data));
+    } else if (receiver->thread() == QThread::currentThread()) {
+        subscriber.callback(data);
+    } else {
+        auto callback = subscriber.callback;
+        QMetaObject::invokeMethod(
+            receiver, [callback, data]() { callback(data); },
+            Qt::QueuedConnection);
+    }
+}
 
-    QSqlQuery query;
-    query.prepare(
-        "INSERT INTO messages (id, channel, data, protocol, priority, "
-        "requires_ack) "
-        "VALUES (:id, :channel, :data, :protocol, :priority, :requires_ack)");
-    query.bindValue(":id", message.messageId);
-    query.bindValue(":channel", message.channel);
-    query.bindValue(":data", QJsonDocument::fromVariant(message.data).toJson());
-    query.bindValue(":protocol", static_cast<int>(message.protocol));
-    query.bindValue(":priority", static_cast<int>(message.priority));
-    query.bindValue(":requires_ack", message.requiresAck);
-    query.exec();
-}
-
-void MessageBus::loadPersistedMessages() {
-    if (!m_persistenceEnabled)
+void MessageBus::persistMessage(const Message &message) {
+    // 大块二进制负载不写入数据库
+    if (!m_persistenceEnabled || message.binary)
         return;
 
-    QSqlQuery query("SELECT * FROM messages ORDER BY priority DESC");
-    while (query.next()) {
+    MessagePersistence::Record record;
+    record.id = message.messageId;
+    record.channel = message.channel;
+    record.data = message.data;
+    record.protocol = static_cast<int>(message.protocol);
+    record.priority = static_cast<int>(message.priority);
+    record.requiresAck = message.requiresAck;
+    m_persistence->insert(record);
+}
+
+void MessageBus::restorePersistedMessages(
+    const QList<MessagePersistence::Record> &records) {
+    for (const MessagePersistence::Record &record : records) {
+        // 协议值用作发送队列和统计的下标, 越界的行无法恢复, 直接删除
+        if (record.protocol < 0 || record.protocol >= ProtocolCount) {
+            qWarning() << "MessageBus: dropping persisted message"
+                       << record.id << "with unknown protocol"
+                       << record.protocol;
+            m_persistence->remove(record.id);
+            continue;
+        }
+
         Message msg;
-        msg.messageId = query.value("id").toString();
-        msg.channel = query.value("channel").toString();
-        msg.data = QJsonDocument::fromJson(query.value("data").toByteArray())
-                       .toVariant();
-        msg.protocol = static_cast<Protocol>(query.value("protocol").toInt());
-        msg.priority = static_cast<Priority>(query.value("priority").toInt());
-        msg.requiresAck = query.value("requires_ack").toBool();
-        enqueueMessage(msg);
+        msg.messageId = record.id;
+        msg.channel = record.channel;
+        msg.data = record.data;
+        msg.protocol = static_cast<Protocol>(record.protocol);
+        msg.priority = clampPriority(record.priority);
+        msg.requiresAck = record.requiresAck;
+        // 已在库中, 无需再次写入; 超出队列容量被丢弃的同时从库中删除
+        if (!enqueueMessage(msg, false)) {
+            m_persistence->remove(msg.messageId);
+        }
     }
 }
 
-QString MessageBus::generateMessageId() {
-    return QUuid::createUuid().toString(QUuid::WithoutBraces);
+MessageBus::MessageId MessageBus::generateMessageId() {
+    // 随机基数避免与上次运行持久化的 ID 冲突; 高 16 位留空, 计数器不会回绕
+    static std::atomic<MessageId> next(
+        (QRandomGenerator::system()->generate64() >> 16) | 1);
+    return next.fetch_add(1, std::memory_order_relaxed);
 }
 
-void MessageBus::enqueueMessage(const Message &message) {
-    // Find the correct position to insert the message based on priority
-    auto it = std::lower_bound(m_messageQueue.begin(), m_messageQueue.end(),
-                               message, [](const Message &a, const Message &b) {
-                                   return a.priority >
-                                          b.priority;  // Higher priority first
-                               });
-    m_messageQueue.insert(it, message);
+QString MessageBus::messageIdToString(MessageId messageId) {
+    return QString::number(messageId, 16).rightJustified(16, QChar('0'));
+}
+
+MessageBus::MessageId MessageBus::messageIdFromString(const QString &text) {
+    bool ok = false;
+    const MessageId messageId = text.toULongLong(&ok, 16);
+    return ok ? messageId : 0;
+}
+
+bool MessageBus::enqueueMessage(const Message &message, bool persist) {
+    Message queued = message;
+    queued.enqueuedAt = m_clock.nsecsElapsed();
+    if (queued.messageId == 0) {
+        queued.messageId = generateMessageId();
+    }
+
+    const QString key = coalesceKeyFor(queued);
+    if (!key.isEmpty()) {
+        auto it = m_coalesced.find(key);
+        if (it != m_coalesced.end()) {
+            // 原地替换, 沿用已有的队列位置和队列深度计数
+            const MessageId replacedId = it.value().messageId;
+            if (m_persistenceEnabled) {
+                m_persistence->remove(replacedId);
+            }
+            m_queuedIndex.insert(queued.messageId,
+                                 m_queuedIndex.take(replacedId));
+            it.value() = queued;
+            ++m_coalescedCount;
+            if (persist && m_persistenceEnabled) {
+                persistMessage(queued);
+            }
+            return true;
+        }
+    }
+
+    if (!reserveQueueSlot(queued)) {
+        return false;
+    }
+    adjustQueueDepth(queued.protocol, queued.priority, 1);
+
+    QueuedEntry entry;
+    entry.protocol = queued.protocol;
+    entry.priority = queued.priority;
+    entry.coalesceKey = key;
+    m_queuedIndex.insert(queued.messageId, entry);
+
+    if (!key.isEmpty()) {
+        m_coalesced.insert(key, queued);
+
+        // 队列中只放占位项, 出队时再取最新内容
+        Message placeholder;
+        placeholder.channel = queued.channel;
+        placeholder.protocol = queued.protocol;
+        placeholder.priority = queued.priority;
+        placeholder.coalesceKey = key;
+        m_sendQueues[placeholder.protocol].enqueue(placeholder,
+                                                   placeholder.priority);
+    } else {
+        // 按优先级分层入队, 同优先级保持 FIFO
+        m_sendQueues[queued.protocol].enqueue(queued, queued.priority);
+    }
 
     // Persist the message if enabled
+    if (persist && m_persistenceEnabled) {
+        persistMessage(queued);
+    }
+
+    scheduleDispatch();
+    return true;
+}
+
+bool MessageBus::reserveQueueSlot(const Message &message) {
+    QueueStats &stats =
+        m_queueStats[queueStatsKey(message.protocol, message.priority)];
+    if (stats.capacity <= 0 || stats.depth < stats.capacity) {
+        return true;
+    }
+
+    switch (stats.policy) {
+        case DropOldest: {
+            // 每个传输独立排队, 同优先级中第一个未确认的即为最早的消息
+            Message oldest;
+            if (m_sendQueues[message.protocol].takeFirstIf(
+                    message.priority,
+                    [this](const Message &queued) {
+                        return isQueuedEntryLive(queued);
+                    },
+                    &oldest)) {
+                ++stats.dropped;
+                discardQueuedMessage(oldest);
+            }
+            return true;
+        }
+        case DropNewest:
+            ++stats.dropped;
+            emit messageDropped(message.channel, message.protocol,
+                                message.priority);
+            return false;
+        case Block:
+            ++stats.rejected;
+            return false;
+    }
+    return true;
+}
+
+void MessageBus::adjustQueueDepth(Protocol protocol, Priority priority,
+                                  int delta) {
+    QueueStats &stats = m_queueStats[queueStatsKey(protocol, priority)];
+    stats.depth += delta;
+
+    bool active = false;
+    if (stats.capacity > 0) {
+        // 滞回: 达到容量进入背压, 回落到 3/4 以下才解除, 避免频繁抖动
+        active = stats.backpressure ? stats.depth > stats.capacity * 3 / 4
+                                    : stats.depth >= stats.capacity;
+    }
+    if (active != stats.backpressure) {
+        stats.backpressure = active;
+        emit backpressureChanged(protocol, priority, active);
+    }
+}
+
+void MessageBus::discardQueuedMessage(const Message &queued) {
+    const Message message = queued.coalesceKey.isEmpty()
+                                ? queued
+                                : m_coalesced.take(queued.coalesceKey);
+    const QueuedEntry entry = m_queuedIndex.take(message.messageId);
+    adjustQueueDepth(entry.protocol, entry.priority, -1);
     if (m_persistenceEnabled) {
-        persistMessage(message);
+        m_persistence->remove(message.messageId);
+    }
+    emit messageDropped(queued.channel, queued.protocol, queued.priority);
+}
+
+bool MessageBus::isQueuedEntryLive(const Message &queued) const {
+    if (!queued.coalesceKey.isEmpty()) {
+        return m_coalesced.contains(queued.coalesceKey);
+    }
+    return m_queuedIndex.contains(queued.messageId);
+}
+
+int MessageBus::queueStatsKey(Protocol protocol, Priority priority) {
+    return static_cast<int>(protocol) * (Critical + 1) +
+           static_cast<int>(priority);
+}
+
+QString MessageBus::coalesceKeyFor(const Message &message) const {
+    const int id = m_channelIds.value(message.channel, -1);
+    if (id < 0 || !m_channels.at(id).coalesce) {
+        return QString();
     }
+
+    const ChannelRecord &record = m_channels.at(id);
+    QString key = message.channel + QChar(0x1f) +
+                  QString::number(static_cast<int>(message.protocol));
+    if (!record.coalesceKeyField.isEmpty()) {
+        key += QChar(0x1f) +
+               message.data.toMap().value(record.coalesceKeyField).toString();
+    }
+    return key;
 }
 
-QJsonObject variantMapToJsonObject(const QVariantMap &variantMap) {
-    QJsonObject jsonObject;
-    for (auto it = variantMap.constBegin(); it != variantMap.constEnd(); ++it) {
-        jsonObject.insert(it.key(), QJsonValue::fromVariant(it.value()));
+void MessageBus::scheduleDispatch() {
+    if (m_dispatchMode != EventDispatch) {
+        return;
+    }
+
+    ++m_pendingSinceFlush;
+    if (m_pendingSinceFlush >= m_batchMaxMessages) {
+        // 攒够一批 (或未启用批处理) 时立即发送
+        m_batchTimer.stop();
+        processMessageQueue();
+    } else if (!m_batchTimer.isActive()) {
+        // QTimer 精度为毫秒, 不足 1ms 的延迟向上取整
+        m_batchTimer.start((m_batchMaxDelayUs + 999) / 1000);
+    }
+}
+
+void MessageBus::onTransportBytesWritten(qint64 bytes) {
+    Q_UNUSED(bytes)
+    if (m_dispatchMode == EventDispatch && hasQueuedMessages()) {
+        processMessageQueue();
     }
-    return jsonObject;
 }
 
 void MessageBus::processMessageQueue() {
-    while (!m_messageQueue.isEmpty()) {
-        Message msg = m_messageQueue.dequeue();
+    // 发送过程中可能经由信号重入, 此时交给外层循环继续处理
+    if (m_processingQueue) {
+        return;
+    }
+    m_processingQueue = true;
+    m_pendingSinceFlush = 0;
+
+    // 各传输轮流每次发送一条, 直到全部清空或阻塞; 阻塞的传输本轮不再尝试
+    std::array<bool, ProtocolCount> stalled{};
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (int i = 0; i < ProtocolCount; ++i) {
+            const int index = (m_nextProtocol + i) % ProtocolCount;
+            const Protocol protocol = static_cast<Protocol>(index);
+            if (stalled[index] || m_sendQueues[index].isEmpty()) {
+                continue;
+            }
+            if (isTransportConnected(protocol) && dispatchNext(protocol)) {
+                progress = true;
+            } else {
+                stalled[index] = true;
+            }
+        }
+        m_nextProtocol = (m_nextProtocol + 1) % ProtocolCount;
+    }
 
-        QJsonObject jsonMessage;
-        jsonMessage["channel"] = msg.channel;
-        jsonMessage["data"] = QJsonValue::fromVariant(msg.data);
-        jsonMessage["priority"] = static_cast<int>(msg.priority);
-        jsonMessage["messageId"] = msg.messageId;
-        jsonMessage["requiresAck"] = msg.requiresAck;
+    m_processingQueue = false;
+}
 
-        QByteArray data =
-            QJsonDocument(jsonMessage).toJson(QJsonDocument::Compact);
+bool MessageBus::hasQueuedMessages() const {
+    for (const auto &queue : m_sendQueues) {
+        if (!queue.isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
 
-        bool sent = false;
-        switch (msg.protocol) {
+bool MessageBus::dispatchNext(Protocol protocol) {
+    auto &sendQueue = m_sendQueues[protocol];
+    const Message queued = sendQueue.dequeue();
+    if (!isQueuedEntryLive(queued)) {
+        // 已被确认的墓碑, 队列深度已在确认时扣除
+        return true;
+    }
+
+    const QString &coalesceKey = queued.coalesceKey;
+    const Message msg =
+        coalesceKey.isEmpty() ? queued : m_coalesced.value(coalesceKey);
+
+    const bool tracked = msg.requiresAck && msg.protocol != HTTP;
+    if (tracked && isAckWindowFull()) {
+        // 待确认数已达窗口上限, 等待确认后再发送
+        sendQueue.prepend(queued, queued.priority);
+        return false;
+    }
+
+    bool sent = false;
+    switch (msg.protocol) {
+        case WebSocket:
+        case TCP:
+        case InProcess: {
+            const WireFormat format = wireFormatFor(msg);
+            sent = transmit(msg, format);
+            break;
+        }
+        case HTTP:
+            m_httpRequestCenter->post(msg.channel, messageToJson(msg));
+            sent = true;  // Assume HTTP requests are always "sent"
+            break;
+    }
+
+    if (!sent) {
+        // If the message couldn't be sent, put it back in the queue
+        // (合并消息只放回占位项, 内容仍留在合并表中)
+        sendQueue.prepend(queued, queued.priority);
+        return false;
+    }
+
+    const QueuedEntry entry = m_queuedIndex.take(msg.messageId);
+    adjustQueueDepth(entry.protocol, entry.priority, -1);
+    if (!coalesceKey.isEmpty()) {
+        m_coalesced.remove(coalesceKey);
+    }
+    m_sendLatency.record(m_clock.nsecsElapsed() - msg.enqueuedAt);
+    if (tracked) {
+        trackInFlight(msg);
+    }
+    if (m_persistenceEnabled && !msg.requiresAck) {
+        // Remove the message from persistence if it doesn't require
+        // acknowledgment
+        m_persistence->remove(msg.messageId);
+    }
+    return true;
+}
+
+bool MessageBus::isAckWindowFull() const {
+    return m_ackWindow > 0 && m_inFlight.size() >= m_ackWindow;
+}
+
+void MessageBus::trackInFlight(const Message &message) {
+    InFlight &entry = m_inFlight[message.messageId];
+    entry.message = message;
+    entry.attempts = 1;
+    entry.sentAtNs = m_clock.nsecsElapsed();
+    entry.deadlineMs = m_clock.elapsed() + retransmitTimeoutMs(1);
+    m_ackWheel.schedule(message.messageId, entry.deadlineMs);
+    if (!m_ackTimer.isActive()) {
+        m_ackTimer.start();
+    }
+}
+
+qint64 MessageBus::retransmitTimeoutMs(int attempts) const {
+    // 有 RTT 样本后按 SRTT + 4 * RTTVAR 估计, 之后每次重传翻倍
+    qint64 base = m_ackInitialTimeoutMs;
+    if (m_ackRtt.count() > 0) {
+        base = qMax(static_cast<qint64>(m_smoothedRttMs + 4 * m_rttVarianceMs),
+                    2 * m_ackWheel.tickMs());
+    }
+    const int shift = qBound(0, attempts - 1, 30);
+    return qMin(base << shift, static_cast<qint64>(m_ackMaxTimeoutMs));
+}
+
+void MessageBus::processAckTimeouts() {
+    const bool windowWasFull = isAckWindowFull();
+    const qint64 nowMs = m_clock.elapsed();
+    QVector<MessageId> expired;
+    m_ackWheel.advance(nowMs, &expired);
+
+    for (MessageId messageId : expired) {
+        auto it = m_inFlight.find(messageId);
+        if (it == m_inFlight.end() || it->deadlineMs > nowMs) {
+            continue;  // 已确认或已重新调度
+        }
+
+        if (m_ackMaxAttempts > 0 && it->attempts >= m_ackMaxAttempts) {
+            const Message message = it->message;
+            m_inFlight.erase(it);
+            ++m_ackStats.expired;
+            if (m_persistenceEnabled) {
+                m_persistence->remove(messageId);
+            }
+            emit messageDropped(message.channel, message.protocol,
+                                message.priority);
+            continue;
+        }
+
+        InFlight &entry = it.value();
+        // 传输断开或写入失败时不计入发送次数, 按当前超时继续等待
+        if (isTransportConnected(entry.message.protocol) &&
+            transmit(entry.message, wireFormatFor(entry.message))) {
+            ++entry.attempts;
+            ++m_ackStats.retransmits;
+            entry.sentAtNs = m_clock.nsecsElapsed();
+        }
+        entry.deadlineMs = nowMs + retransmitTimeoutMs(entry.attempts);
+        m_ackWheel.schedule(messageId, entry.deadlineMs);
+    }
+
+    if (m_inFlight.isEmpty()) {
+        m_ackTimer.stop();
+        m_ackWheel.clear();
+    }
+    if (windowWasFull && !isAckWindowFull() &&
+        m_dispatchMode == EventDispatch) {
+        processMessageQueue();
+    }
+}
+
+void MessageBus::sendAck(const Message &message) {
+    if (message.messageId == 0 || message.protocol == HTTP) {
+        return;
+    }
+
+    Message ack;
+    ack.channel = kAckChannel;
+    ack.data = messageIdToString(message.messageId);
+    ack.protocol = message.protocol;
+    ack.priority = Critical;
+    // 确认直接写出, 不在队列中等待, 以免拉长对端测得的 RTT
+    if (isTransportConnected(ack.protocol) &&
+        transmit(ack, wireFormatFor(ack))) {
+        return;
+    }
+    enqueueMessage(ack, false);
+}
+
+bool MessageBus::isTransportConnected(Protocol protocol) const {
+    if (m_ioWorker && (protocol == WebSocket || protocol == TCP)) {
+        return m_ioWorker->isConnected(protocol);
+    }
+    switch (protocol) {
+        case WebSocket:
+            return m_webSocketClient->isConnected();
+        case TCP:
+            return m_tcpClient->isConnected();
+        case HTTP:
+            return true;
+        case InProcess:
+            return m_inProcessEndpoint->isConnected();
+    }
+    return false;
+}
+
+bool MessageBus::transmit(const Message &message, WireFormat format) {
+    qint64 bytes = 0;
+    if (message.protocol == InProcess) {
+        const QByteArray frame = encodeMessage(message, format);
+        if (!m_inProcessEndpoint->sendFrame(frame)) {
+            return false;
+        }
+        bytes = frame.size();
+    } else if (m_ioWorker) {
+        // 编码与写入在 I/O 线程完成, 字节数由 worker 统计
+        if (!isTransportConnected(message.protocol) ||
+            !m_ioWorker->submit(message, format)) {
+            return false;
+        }
+    } else {
+        bytes = writeMessage(m_webSocketClient, m_tcpClient, message, format);
+        if (bytes < 0) {
+            return false;
+        }
+    }
+    countSent(message.channel, bytes);
+    if (m_recorder) {
+        m_recorder->record(message, MessageRecorder::Outbound);
+    }
+    return true;
+}
+
+qint64 MessageBus::writeMessage(WebSocketClient *webSocketClient,
+                                TcpClient *tcpClient, const Message &message,
+                                WireFormat format) {
+    if (message.binary) {
+        const QByteArray header = encodeBinaryHeader(message);
+        const QByteArray payload = message.data.toByteArray();
+        switch (message.protocol) {
             case WebSocket:
-                if (m_webSocketClient->isConnected()) {
-                    m_webSocketClient->sendTextMessage(QString::fromUtf8(data));
-                    sent = true;
-                }
-                break;
+                // 客户端帧必须逐字节掩码, QWebSocket 总要复制一次负载,
+                // 这里只合并为一次分配
+                webSocketClient->sendBinaryMessage(header + payload);
+                return header.size() + payload.size();
             case TCP:
-                if (m_tcpClient->isConnected()) {
-                    m_tcpClient->sendData(data);
-                    sent = true;
-                }
-                break;
+                tcpClient->sendFrame(header, payload);
+                return header.size() + payload.size();
             case HTTP:
-                QVariantMap jsonMessageMap = jsonMessage.toVariantMap();
-                QJsonObject jsonMessage =
-                    variantMapToJsonObject(jsonMessageMap);
-                m_httpRequestCenter->post(msg.channel, jsonMessage);
-                sent = true;  // Assume HTTP requests are always "sent"
+            case InProcess:
                 break;
         }
+        return -1;
+    }
 
-        if (sent) {
-            if (m_persistenceEnabled && !msg.requiresAck) {
-                // Remove the message from persistence if it doesn't require
-                // acknowledgment
-                QSqlQuery query;
-                query.prepare("DELETE FROM messages WHERE id = :id");
-                query.bindValue(":id", msg.messageId);
-                query.exec();
+    const QByteArray frame = encodeMessage(message, format);
+    switch (message.protocol) {
+        case WebSocket:
+            if (format == Cbor) {
+                webSocketClient->sendBinaryMessage(frame);
+            } else {
+                webSocketClient->sendTextData(frame);
             }
-        } else {
-            // If the message couldn't be sent, put it back in the queue
-            m_messageQueue.prepend(msg);
-            break;  // Stop processing for now
+            return frame.size();
+        case TCP:
+            tcpClient->sendData(frame);
+            return frame.size();
+        case HTTP:
+        case InProcess:
+            break;
+    }
+    return -1;
+}
+
+void MessageBus::countSent(const QString &channel, qint64 bytes) {
+    if (!m_metricsEnabled) {
+        return;
+    }
+    ChannelMetrics &metrics = metricsFor(channel);
+    ++metrics.sentMessages;
+    metrics.sentBytes += bytes;
+}
+
+void MessageBus::sendHello(Protocol protocol) {
+    if (m_helloSent.value(protocol, false) || !isTransportConnected(protocol)) {
+        return;
+    }
+
+    // 只有本端配置了 CBOR 时才发起握手, 避免向旧版对端发送未知频道
+    bool wantsCbor = m_wireFormats.value(protocol, Json) == Cbor;
+    for (auto it = m_channelWireFormats.constBegin();
+         !wantsCbor && it != m_channelWireFormats.constEnd(); ++it) {
+        wantsCbor = it.value() == Cbor;
+    }
+    const bool wantsCompression =
+        protocol == WebSocket && m_webSocketCompression;
+    if (!wantsCbor && !wantsCompression &&
+        !m_peerSupportsCbor.contains(protocol)) {
+        return;
+    }
+
+    QVariantMap capabilities{{"formats", QStringList{"json", "cbor"}}};
+    if (wantsCompression) {
+        capabilities.insert("compression",
+                            QStringList{QString(DeflateCodec::Name)});
+    }
+
+    Message hello;
+    hello.channel = kHelloChannel;
+    hello.data = capabilities;
+    hello.protocol = protocol;
+    hello.priority = Critical;
+    hello.requiresAck = false;
+    // 握手本身始终使用 JSON, 保证任意对端都能解析
+    if (transmit(hello, Json)) {
+        m_helloSent[protocol] = true;
+    }
+}
+
+void MessageBus::handleIncomingFrame(const QByteArray &frame,
+                                     Protocol protocol) {
+    Message msg;
+    if (decodeMessage(frame, protocol, &msg)) {
+        msg.enqueuedAt = m_clock.nsecsElapsed();
+        handleIncomingMessage(msg);
+    }
+}
+
+void MessageBus::handleIncomingMessage(const Message &message) {
+    if (m_recorder) {
+        m_recorder->record(message, MessageRecorder::Inbound);
+    }
+    if (message.channel == kHelloChannel) {
+        const QVariantMap capabilities = message.data.toMap();
+        const QStringList formats =
+            capabilities.value("formats").toStringList();
+        m_peerSupportsCbor[message.protocol] = formats.contains("cbor");
+        if (message.protocol == WebSocket) {
+            m_peerSupportsCompression =
+                capabilities.value("compression").toStringList().contains(
+                    QString(DeflateCodec::Name));
+            WebSocketClient *client = m_webSocketClient;
+            const bool peer =
+                m_webSocketCompression && m_peerSupportsCompression;
+            runOnIoThread(
+                [client, peer]() { client->setPeerCompression(peer); });
         }
+        // 对端先发起握手时回应本端能力
+        sendHello(message.protocol);
+        return;
+    }
+
+    if (message.channel == kAckChannel) {
+        acknowledgeMessage(messageIdFromString(message.data.toString()));
+        return;
+    }
+
+    // 无论是否被过滤或路由, 收到即确认
+    if (message.requiresAck) {
+        sendAck(message);
+    }
+    distributeMessage(message);
+}
+
+MessageBus::WireFormat MessageBus::wireFormatFor(const Message &message) const {
+    const WireFormat preferred = m_channelWireFormats.value(
+        message.channel, m_wireFormats.value(message.protocol, Json));
+    if (preferred == Cbor &&
+        m_peerSupportsCbor.value(message.protocol, false)) {
+        return Cbor;
+    }
+    return Json;
+}
+
+QJsonObject MessageBus::messageToJson(const Message &message) {
+    QJsonObject jsonMessage;
+    jsonMessage["channel"] = message.channel;
+    jsonMessage["data"] = QJsonValue::fromVariant(message.data);
+    jsonMessage["priority"] = static_cast<int>(message.priority);
+    jsonMessage["messageId"] = messageIdToString(message.messageId);
+    jsonMessage["requiresAck"] = message.requiresAck;
+    return jsonMessage;
+}
+
+QByteArray MessageBus::encodeMessage(const Message &message,
+                                     WireFormat format) {
+    if (message.binary) {
+        return encodeBinaryHeader(message) + message.data.toByteArray();
+    }
+    if (format == Cbor) {
+        QCborMap map;
+        map.insert(CborChannel, message.channel);
+        map.insert(CborData, QCborValue::fromVariant(message.data));
+        map.insert(CborPriority, static_cast<qint64>(message.priority));
+        map.insert(CborMessageId, static_cast<qint64>(message.messageId));
+        map.insert(CborRequiresAck, message.requiresAck);
+        return map.toCborValue().toCbor();
+    }
+    return QJsonDocument(messageToJson(message)).toJson(QJsonDocument::Compact);
+}
+
+QByteArray MessageBus::encodeBinaryHeader(const Message &message) {
+    const QByteArray channel = message.channel.toUtf8();
+    QByteArray header(kBinaryHeaderFixedSize, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(header.data());
+    out[0] = kBinaryFrameMagic;
+    out[1] = message.requiresAck ? kBinaryFlagRequiresAck : 0;
+    out[2] = static_cast<uchar>(message.priority);
+    out[3] = 0;
+    qToBigEndian<quint64>(message.messageId, out + 4);
+    qToBigEndian<quint16>(static_cast<quint16>(channel.size()), out + 12);
+    header.append(channel);
+    return header;
+}
+
+bool MessageBus::decodeMessage(const QByteArray &frame, Protocol protocol,
+                               Message *message) {
+    if (frame.isEmpty()) {
+        return false;
+    }
+
+    // CBOR map 的首字节主类型为 5 (0xA0-0xBF), JSON 对象以 '{' 开头
+    const uchar lead = static_cast<uchar>(frame.at(0));
+    if (lead == kBinaryFrameMagic) {
+        if (frame.size() < kBinaryHeaderFixedSize) {
+            return false;
+        }
+        const uchar *in = reinterpret_cast<const uchar *>(frame.constData());
+        const int channelSize = qFromBigEndian<quint16>(in + 12);
+        const qsizetype payloadOffset = kBinaryHeaderFixedSize + channelSize;
+        if (frame.size() < payloadOffset) {
+            return false;
+        }
+        message->channel = QString::fromUtf8(
+            frame.constData() + kBinaryHeaderFixedSize, channelSize);
+        message->data = frame.sliced(payloadOffset);
+        message->priority = clampPriority(in[2]);
+        message->messageId = qFromBigEndian<quint64>(in + 4);
+        message->requiresAck = (in[1] & kBinaryFlagRequiresAck) != 0;
+        message->binary = true;
+    } else if ((lead & 0xE0) == 0xA0) {
+        QCborParserError parseError;
+        const QCborValue value = QCborValue::fromCbor(frame, &parseError);
+        if (parseError.error != QCborError::NoError || !value.isMap()) {
+            return false;
+        }
+        const QCborMap map = value.toMap();
+        message->channel = map.value(CborChannel).toString();
+        message->data = map.value(CborData).toVariant();
+        message->priority = clampPriority(map.value(CborPriority).toInteger());
+        const QCborValue messageId = map.value(CborMessageId);
+        message->messageId =
+            messageId.isInteger()
+                ? static_cast<MessageId>(messageId.toInteger())
+                : messageIdFromString(messageId.toString());
+        message->requiresAck = map.value(CborRequiresAck).toBool();
+    } else {
+        QJsonDocument doc = QJsonDocument::fromJson(frame);
+        if (!doc.isObject()) {
+            return false;
+        }
+        QJsonObject obj = doc.object();
+        message->channel = obj["channel"].toString();
+        message->data = obj["data"].toVariant();
+        message->priority = clampPriority(obj["priority"].toInt());
+        message->messageId = messageIdFromString(obj["messageId"].toString());
+        message->requiresAck = obj["requiresAck"].toBool();
     }
+    message->protocol = protocol;
+    message->wireSize = static_cast<int>(frame.size());
+    return true;
 }
 
 // Add these utility methods to help with JSON conversion
@@ -1,31 +1,104 @@
 #ifndef MESSAGEBUS_H
 #define MESSAGEBUS_H
 
+#include <QCache>
+#include <QElapsedTimer>
 #include <QHash>
+#include <QMetaMethod>
 #include <QObject>
+#include <QPointer>
 #include <QQueue>
 #include <QVariant>
-#include <QtSql/QSqlDatabase>
+#include <array>
 
 #include "Connection/Http.h"
+#include "Connection/InProcess.h"
 #include "Connection/Tcp.h"
 #include "Connection/WebSocket.h"
+#include "Core/FilterExpression.h"
+#include "Core/LatencyHistogram.h"
+#include "Core/MessagePersistence.h"
+#include "Core/PriorityQueue.h"
+#include "Core/TimerWheel.h"
+#include "Core/TopicTrie.h"
+
+class MessageBusIoWorker;
+class MessageRecorder;
 
 class MessageBus : public QObject {
     Q_OBJECT
+    friend class MessageBusIoWorker;
+    friend class MessageReplayer;
 
 public:
-    enum Protocol { WebSocket, TCP, HTTP };
+    // 进程内单调递增的 64 位消息 ID, 0 表示无效
+    using MessageId = quint64;
+
+    // InProcess: 经 connectInProcess() 与同进程内另一个总线直连, 不使用套接字
+    enum Protocol { WebSocket, TCP, HTTP, InProcess };
+    static constexpr int ProtocolCount = InProcess + 1;
 
     enum Priority { Low, Normal, High, Critical };
 
+    // TimerDispatch: 每 100ms 轮询一次队列 (默认)
+    // EventDispatch: 入队、连接建立和数据写出后立即发送
+    enum DispatchMode { TimerDispatch, EventDispatch };
+
+    // 线路编码: Json 为默认及回退格式, Cbor 需对端在握手中声明支持
+    enum WireFormat { Json, Cbor };
+
+    // 队列满时的处理策略
+    enum OverflowPolicy {
+        DropOldest,  // 丢弃同协议同优先级中最早的消息
+        DropNewest,  // 丢弃新消息
+        Block        // 拒绝新消息并保持背压, 由生产者等待 backpressureChanged
+    };
+
+    struct QueueStats {
+        int depth = 0;
+        int capacity = 0;  // <= 0 表示不限
+        OverflowPolicy policy = DropOldest;
+        quint64 dropped = 0;   // DropOldest/DropNewest 丢弃的消息数
+        quint64 rejected = 0;  // Block 策略下被拒绝的消息数
+        bool backpressure = false;
+    };
+
+    // 频道收发计数; 速率为相邻两次 channelMetrics() 调用之间的平均值
+    struct ChannelMetrics {
+        quint64 sentMessages = 0;
+        quint64 sentBytes = 0;
+        quint64 receivedMessages = 0;
+        quint64 receivedBytes = 0;
+        quint64 filterDrops = 0;  // 被过滤器丢弃的接收消息
+        quint64 routeHits = 0;    // 被路由规则转发的接收消息
+        double sentMessageRate = 0.0;  // 条/秒
+        double sentByteRate = 0.0;     // 字节/秒
+        double receivedMessageRate = 0.0;
+        double receivedByteRate = 0.0;
+    };
+
+    // requiresAck 消息的确认统计
+    struct AckStats {
+        int inFlight = 0;  // 已发送待确认的消息数
+        int window = 0;    // 允许的最大待确认数
+        quint64 acknowledged = 0;
+        quint64 retransmits = 0;
+        quint64 expired = 0;  // 超过最大发送次数后放弃的消息数
+        double smoothedRttMs = 0.0;
+        qint64 retransmitTimeoutMs = 0;  // 当前首次重传超时
+    };
+
     struct Message {
         QString channel;
         QVariant data;
-        Protocol protocol;
-        Priority priority;
-        QString messageId;
-        bool requiresAck;
+        Protocol protocol = WebSocket;
+        Priority priority = Normal;
+        MessageId messageId = 0;
+        bool requiresAck = false;
+        qint64 enqueuedAt = 0;   // 入队或接收时间 (ns, 单调时钟)
+        int wireSize = 0;        // 接收时的帧大小, 由解码填写
+        QString coalesceKey;     // 非空表示队列中的占位项, 实际内容见合并表
+        bool binary = false;     // data 为 QByteArray, 以二进制帧原样发送
     };
 
     explicit MessageBus(QObject *parent = nullptr);
@@ -35,73 +108,339 @@ public:
     void connectWebSocket(const QString &url);
     void connectTcp(const QString &host, quint16 port);
     void configureHttp(const QString &baseUrl);
+    // 两个总线之间建立进程内连接 (可位于不同线程), 收发仍经过编解码和队列,
+    // 用于脱离网络测量总线本身的开销. capacity 为每个方向积压的帧数上限
+    static void connectInProcess(MessageBus *first, MessageBus *second,
+                                 int capacity = 4096);
+    void disconnectInProcess();
 
-    // 发送消息
-    void sendMessage(const QString &channel, const QVariant &message,
+    // 发送消息, 因队列容量限制未被接收时返回 false
+    bool sendMessage(const QString &channel, const QVariant &message,
                      Protocol protocol = WebSocket, Priority priority = Normal,
                      bool requiresAck = false);
+    // 发送二进制负载 (图像帧、FITS 数据块等): 不经过 JSON/base64,
+    // QByteArray 以隐式共享方式一直传到传输层, 前面只加一个小帧头.
+    // 对端需同样使用 MessageBus 才能解析, 订阅者收到的 QVariant 中为 QByteArray
+    bool sendBinaryMessage(const QString &channel, const QByteArray &payload,
+                           Protocol protocol = WebSocket,
+                           Priority priority = Normal,
+                           bool requiresAck = false);
 
     // 订阅和取消订阅频道
+    // method 为槽名 (如 "onData") 或完整签名, 槽需接受一个 QVariant 参数
+    // channel 支持 MQTT 风格通配符, 如 "camera/+/temp", "mount/#".
+    // 通配符的匹配结果按具体主题缓存, 最多 MaxWildcardCacheEntries 个
+    static constexpr int MaxWildcardCacheEntries = 1024;
     void subscribe(const QString &channel, QObject *receiver,
                    const char *method);
+    // 回调在 context 所在线程执行, context 销毁后自动失效
+    void subscribe(const QString &channel, QObject *context,
+                   std::function<void(const QVariant &)> callback);
+    // method 为空时移除该 receiver 在此频道上的全部订阅
     void unsubscribe(const QString &channel, QObject *receiver,
-                     const char *method);
+                     const char *method = nullptr);
 
     // 设置自动重连
     void setAutoReconnect(bool enable, Protocol protocol);
 
     // 新增方法
+    // 持久化在独立线程中批量提交, flushIntervalMs 为提交间隔
     void setPersistenceEnabled(bool enable);
+    void setPersistenceFlushInterval(int msecs);
+    MessagePersistence::Stats persistenceStats() const;
     void setMessageFilter(const QString &channel,
                           std::function<bool(const QVariant &)> filter);
+    // 以表达式设置过滤器 (语法见 FilterExpression), 只编译一次,
+    // 如 "temp > -20 && status == \"ok\" && rate(5)".
+    // 表达式有误时返回 false, 原过滤器保持不变
+    bool setMessageFilter(const QString &channel, const QString &expression);
+    // 替换该频道的全部路由为单个目标
     void setRouteRule(const QString &sourceChannel,
                       const QString &targetChannel, Protocol targetProtocol);
-    void acknowledgeMessage(const QString &messageId);
+    // 追加路由目标, 一条消息可转发到多个目标. condition 为过滤表达式,
+    // 为空时总是转发; 没有任何目标满足条件时消息照常在本地分发
+    bool addRouteRule(const QString &sourceChannel,
+                      const QString &targetChannel, Protocol targetProtocol,
+                      const QString &condition = QString());
+    void clearRouteRules(const QString &sourceChannel);
+    // 通过 ID 索引定位, 不扫描队列
+    void acknowledgeMessage(MessageId messageId);
+
+    // 确认与重传 (仅 WebSocket/TCP): 收到 requiresAck 消息时自动回复确认,
+    // 发送方超时未收到确认则按指数退避重传. 语义为至少一次, 接收方可能
+    // 收到重复消息. 待确认数达到 window 时暂停发送, 直到有消息被确认.
+    // window <= 0 表示不限窗口, maxAttempts <= 0 表示不限重传次数
+    void setAckWindow(int window);
+    void setAckRetransmit(int initialTimeoutMs, int maxTimeoutMs,
+                          int maxAttempts);
+    AckStats ackStats() const;
+    const LatencyHistogram &ackRttHistogram() const;
+
+    // 合并模式 ("最新值优先"): 同一频道 (及 keyField 字段值) 尚未发送的
+    // 消息会被新消息原地替换, 积压量只取决于频道数而非更新频率
+    void setChannelCoalescing(const QString &channel, bool enable,
+                              const QString &keyField = QString());
+    quint64 coalescedMessageCount() const;
+
+    // 队列容量与背压: 按协议和优先级分别限制, capacity <= 0 表示不限
+    // 达到容量时进入背压, 回落到容量的 3/4 以下时解除
+    void setQueueCapacity(Protocol protocol, Priority priority, int capacity,
+                          OverflowPolicy policy = DropOldest);
+    QueueStats queueStats(Protocol protocol, Priority priority) const;
+    quint64 droppedMessageCount() const;
+    bool isBackpressured(Protocol protocol) const;
+
+    // 发送调度
+    void setDispatchMode(DispatchMode mode);
+    DispatchMode dispatchMode() const;
+    // 仅在 EventDispatch 下生效: 累计 maxMessages 条或等待 maxDelayUs 微秒后
+    // 统一发送; 两者都 <= 1/0 时每次入队立即发送
+    void setMicroBatching(int maxMessages, int maxDelayUs);
+
+    // 线路编码 (按连接或按频道选择, 频道设置优先)
+    void setWireFormat(Protocol protocol, WireFormat format);
+    void setChannelWireFormat(const QString &channel, WireFormat format);
+    WireFormat negotiatedWireFormat(Protocol protocol) const;
+
+    // TCP 分帧方式, 默认使用长度前缀 (需与对端一致).
+    // 总线在 TCP 上还会发送 CBOR 和二进制帧, 其中可能出现 '\n',
+    // 因此不接受 NewlineDelimited, 返回 false 且保持原设置
+    bool setTcpFramingMode(FrameBuffer::Mode mode);
+    // TCP 写入合并方式, 默认 LowLatency (TCP_NODELAY)
+    void setTcpWriteMode(TcpClient::WriteMode mode);
+    // TCP 断线期间的排队上限 (字节) 与重连后的重放策略, 见 TcpClient
+    void setTcpSendQueueLimit(qint64 maxBytes);
+    void setTcpReplayPolicy(TcpClient::ReplayPolicy policy,
+                            int latestCount = 0);
+    // TCP 断线排队与丢弃统计; 启用 I/O 线程时在该线程中读取
+    TcpClient::SendQueueStats tcpSendQueueStats() const;
+    // WebSocket 应用层压缩 (见 WebSocketClient), 通过握手与对端协商,
+    // 双方都开启时才压缩发送
+    void setWebSocketCompression(bool enable, int minSize = 256);
+    // JSON 以二进制帧发送, 对端需为 MessageBus
+    void setWebSocketBinaryFirst(bool enable);
+    // WebSocket ping 心跳与死链检测, 参数含义见 WebSocketClient
+    void setWebSocketHeartbeat(int intervalMsecs, double deadRttMultiple = 4.0);
+    WebSocketClient::LatencyStats webSocketLatency() const;
+
+    // 在独立线程中运行 WebSocket/TCP 的收发与编解码, 订阅者仍在各自线程回调
+    void setIoThreadEnabled(bool enable);
+    bool isIoThreadEnabled() const;
+
+    // 线路编解码, 可在任意线程调用
+    static QJsonObject messageToJson(const Message &message);
+    static QByteArray encodeMessage(const Message &message, WireFormat format);
+    static bool decodeMessage(const QByteArray &frame, Protocol protocol,
+                              Message *message);
+    // JSON 中以 16 位十六进制字符串传递 ID, 避免超出 double 精度
+    static QString messageIdToString(MessageId messageId);
+    static MessageId messageIdFromString(const QString &text);
+
+    // 入队到写入传输层的延迟统计
+    const LatencyHistogram &sendLatencyHistogram() const;
+    void resetSendLatencyHistogram();
+
+    // 运行指标 (默认开启): 频道计数与速率、接收到分发的延迟;
+    // 队列深度见 queueStats(). 每条消息只增加一次哈希查找和几次计数.
+    // 只为计数而登记的频道 (无订阅/过滤/路由) 最多 MaxMetricsOnlyChannels
+    // 个, 之后出现的新频道合并计入 OtherChannelsKey
+    static constexpr int MaxMetricsOnlyChannels = 1024;
+    static const QString OtherChannelsKey;
+    void setMetricsEnabled(bool enable);
+    bool isMetricsEnabled() const;
+    QHash<QString, ChannelMetrics> channelMetrics();
+    const LatencyHistogram &dispatchLatencyHistogram() const;
+    void resetMetrics();
+
+    // 把收发的消息连同时间戳录制到文件 (覆盖已有文件),
+    // 用 MessageReplayer 回放. 录制在总线所在线程同步写入
+    bool startRecording(const QString &path);
+    void stopRecording();
+    bool isRecording() const;
 
 signals:
     void messageReceived(const QString &channel, const QVariant &message);
     void connected(Protocol protocol);
     void disconnected(Protocol protocol);
     void error(Protocol protocol, const QString &errorMessage);
-    void messageAcknowledged(const QString &messageId);
+    void messageAcknowledged(quint64 messageId);
+    void backpressureChanged(Protocol protocol, Priority priority,
+                             bool active);
+    void messageDropped(const QString &channel, Protocol protocol,
+                        Priority priority);
 
 private slots:
     void onWebSocketConnected();
     void onWebSocketDisconnected();
     void onWebSocketError(QAbstractSocket::SocketError error);
     void onWebSocketMessageReceived(const QString &message);
+    void onWebSocketBinaryMessageReceived(const QByteArray &message);
 
     void onTcpConnected();
     void onTcpDisconnected();
     void onTcpError(QAbstractSocket::SocketError error);
     void onTcpDataReceived(const QByteArray &data);
 
+    void onInProcessConnected();
+    void onInProcessDisconnected();
+    void onInProcessReadyRead();
+
     void onHttpRequestFinished(HttpRequest *request, int statusCode,
                                const QByteArray &response);
     void onHttpRequestError(HttpRequest *request, const QString &errorString);
 
     void processMessageQueue();
+    void onTransportBytesWritten(qint64 bytes);
+    void drainInbound();
+    void onIoWriteFailed();
+    void processAckTimeouts();
 
 private:
     WebSocketClient *m_webSocketClient;
     TcpClient *m_tcpClient;
     HttpRequestCenter *m_httpRequestCenter;
+    InProcessEndpoint *m_inProcessEndpoint;
+
+    struct Subscriber {
+        QPointer<QObject> receiver;
+        QByteArray method;       // 订阅时传入的名称, 用于取消订阅
+        QMetaMethod metaMethod;  // 订阅时预解析, 分发时无需按名称查找
+        std::function<void(const QVariant &)> callback;
+    };
+
+    struct RouteTarget {
+        QString channel;
+        Protocol protocol = WebSocket;
+        std::function<bool(const QVariant &)> condition;
+    };
+
+    // 频道在首次使用时分配整数 ID, 过滤器/路由/订阅者集中存放在一条记录中
+    struct ChannelRecord {
+        QString name;
+        std::function<bool(const QVariant &)> filter;
+        QVector<RouteTarget> routes;
+        bool coalesce = false;
+        QString coalesceKeyField;
+        QVector<Subscriber> subscribers;
+        ChannelMetrics metrics;   // 速率字段仅在快照中填写
+        ChannelMetrics previous;  // 上次快照时的计数, 用于计算速率
+    };
 
-    QHash<QString, QList<QPair<QObject *, const char *>>> m_subscribers;
-    QHash<QString, std::function<bool(const QVariant &)>> m_filters;
-    QHash<QString, QPair<QString, Protocol>> m_routeRules;
+    QHash<QString, int> m_channelIds;
+    QVector<ChannelRecord> m_channels;
+    TopicTrie<Subscriber> m_wildcardSubscribers;
+    // 具体主题 -> 匹配到的通配符订阅者 (LRU), 不为主题建立频道记录
+    QCache<QString, QVector<Subscriber>> m_wildcardMatches;
 
-    QQueue<Message> m_messageQueue;
+    // 每个传输一条独立的发送队列, 某个传输阻塞时不影响其它传输
+    std::array<PriorityQueue<Message, Critical + 1>, ProtocolCount>
+        m_sendQueues;
+    int m_nextProtocol;  // 轮询起点, 保证各传输公平发送
+    QHash<QString, Message> m_coalesced;  // 合并键 -> 最新的未发送消息
+    quint64 m_coalescedCount;
+    QHash<int, QueueStats> m_queueStats;  // 键: queueStatsKey(协议, 优先级)
     QTimer m_queueProcessTimer;
 
+    // 队列中未发送消息的索引; 确认时移除, 队列中的条目成为墓碑, 出队时跳过
+    struct QueuedEntry {
+        Protocol protocol = WebSocket;
+        Priority priority = Normal;  // 计入队列深度时的优先级
+        QString coalesceKey;         // 非空表示内容在合并表中
+    };
+    QHash<MessageId, QueuedEntry> m_queuedIndex;
+
+    // 已发送待确认的消息, 截止时间存放在时间轮中
+    struct InFlight {
+        Message message;
+        int attempts = 0;       // 已发送次数
+        qint64 sentAtNs = 0;    // 最近一次发送时间
+        qint64 deadlineMs = 0;  // 与时间轮中的条目核对, 不一致即已过期
+    };
+    QHash<MessageId, InFlight> m_inFlight;
+    TimerWheel<MessageId> m_ackWheel;
+    QTimer m_ackTimer;
+    int m_ackWindow;
+    int m_ackInitialTimeoutMs;
+    int m_ackMaxTimeoutMs;
+    int m_ackMaxAttempts;
+    double m_smoothedRttMs;  // RFC 6298 SRTT/RTTVAR, 无样本时为 0
+    double m_rttVarianceMs;
+    AckStats m_ackStats;
+    LatencyHistogram m_ackRtt;
+
+    DispatchMode m_dispatchMode;
+    int m_batchMaxMessages;
+    int m_batchMaxDelayUs;
+    int m_pendingSinceFlush;
+    bool m_processingQueue;
+    QTimer m_batchTimer;
+    QElapsedTimer m_clock;
+    LatencyHistogram m_sendLatency;
+
+    bool m_metricsEnabled;
+    int m_metricsOnlyChannels;
+    ChannelRecord m_otherChannels;  // 超出登记上限的频道合计
+    qint64 m_lastMetricsAt;  // 上次快照时间 (ns)
+    LatencyHistogram m_dispatchLatency;
+
+    QHash<Protocol, WireFormat> m_wireFormats;
+    QHash<QString, WireFormat> m_channelWireFormats;
+    QHash<Protocol, bool> m_peerSupportsCbor;
+    QHash<Protocol, bool> m_helloSent;
+    bool m_webSocketCompression;
+    bool m_peerSupportsCompression;  // 对端握手中声明了相同的压缩方式
+
     bool m_persistenceEnabled;
-    QSqlDatabase m_database;
+    int m_persistenceFlushInterval;
+    MessagePersistence *m_persistence;
+
+    QThread *m_ioThread;
+    MessageBusIoWorker *m_ioWorker;
+
+    MessageRecorder *m_recorder;
 
     void distributeMessage(const Message &message);
+    int internChannel(const QString &channel);
+    ChannelMetrics &metricsFor(const QString &channel);
+    void addSubscriber(const QString &channel, const Subscriber &subscriber);
+    QVector<Subscriber> wildcardSubscribersFor(const QString &topic);
+    void invokeSubscriber(const Subscriber &subscriber, const QVariant &data);
     void persistMessage(const Message &message);
-    void loadPersistedMessages();
-    QString generateMessageId();
-    void enqueueMessage(const Message &message);
+    void restorePersistedMessages(
+        const QList<MessagePersistence::Record> &records);
+    static MessageId generateMessageId();
+    bool enqueueMessage(const Message &message, bool persist = true);
+    bool reserveQueueSlot(const Message &message);
+    void adjustQueueDepth(Protocol protocol, Priority priority, int delta);
+    void discardQueuedMessage(const Message &queued);
+    void requeueFailedWrites(const QList<Message> &messages);
+    bool isQueuedEntryLive(const Message &queued) const;
+    static int queueStatsKey(Protocol protocol, Priority priority);
+    void scheduleDispatch();
+    bool hasQueuedMessages() const;
+    bool dispatchNext(Protocol protocol);
+    bool isAckWindowFull() const;
+    void trackInFlight(const Message &message);
+    qint64 retransmitTimeoutMs(int attempts) const;
+    void sendAck(const Message &message);
+    QString coalesceKeyFor(const Message &message) const;
+
+    bool isTransportConnected(Protocol protocol) const;
+    bool transmit(const Message &message, WireFormat format);
+    // 编码并写入传输层, I/O 线程中也使用
+    // 返回写出的字节数, 失败时返回 -1
+    static qint64 writeMessage(WebSocketClient *webSocketClient,
+                               TcpClient *tcpClient, const Message &message,
+                               WireFormat format);
+    void countSent(const QString &channel, qint64 bytes);
+    static QByteArray encodeBinaryHeader(const Message &message);
+    void sendHello(Protocol protocol);
+    void handleIncomingFrame(const QByteArray &frame, Protocol protocol);
+    void handleIncomingMessage(const Message &message);
+    WireFormat wireFormatFor(const Message &message) const;
+    void connectTransportSignals(bool receiveData);
+    void runOnIoThread(const std::function<void()> &task);
+    void shutdownIoThread(bool deliverInbound);
     QJsonValue variantToJson(const QVariant &val);
     QVariant jsonToVariant(const QJsonValue &val);
 };
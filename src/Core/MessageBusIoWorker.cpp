@@ -0,0 +1,178 @@
+#include "MessageBusIoWorker.h"
+
+MessageBusIoWorker::MessageBusIoWorker(WebSocketClient *webSocketClient,
+                                       TcpClient *tcpClient,
+                                       const QElapsedTimer &clock,
+                                       int ringCapacity)
+    : QObject(nullptr),
+      m_webSocketClient(webSocketClient),
+      m_tcpClient(tcpClient),
+      m_clock(clock),
+      m_outbound(ringCapacity),
+      m_inbound(ringCapacity),
+      m_webSocketConnected(webSocketClient->isConnected()),
+      m_tcpConnected(tcpClient->isConnected()),
+      m_outboundScheduled(false),
+      m_outboundWasFull(false),
+      m_inboundScheduled(false),
+      m_inboundBacklogged(false) {
+    connect(m_webSocketClient, &WebSocketClient::connected, this,
+            [this]() { m_webSocketConnected = true; });
+    connect(m_webSocketClient, &WebSocketClient::disconnected, this,
+            [this]() { m_webSocketConnected = false; });
+    connect(m_webSocketClient, &WebSocketClient::textMessageReceived, this,
+            [this](const QString &message) {
+                onFrameReceived(message.toUtf8(), MessageBus::WebSocket);
+            });
+    connect(m_webSocketClient, &WebSocketClient::binaryMessageReceived, this,
+            [this](const QByteArray &message) {
+                onFrameReceived(message, MessageBus::WebSocket);
+            });
+
+    connect(m_tcpClient, &TcpClient::connected, this,
+            [this]() { m_tcpConnected = true; });
+    connect(m_tcpClient, &TcpClient::disconnected, this,
+            [this]() { m_tcpConnected = false; });
+    connect(m_tcpClient, &TcpClient::dataReceived, this,
+            [this](const QByteArray &data) {
+                onFrameReceived(data, MessageBus::TCP);
+            });
+}
+
+bool MessageBusIoWorker::submit(const MessageBus::Message &message,
+                                MessageBus::WireFormat format) {
+    Outbound item;
+    item.message = message;
+    item.format = format;
+    if (!m_outbound.tryPush(std::move(item))) {
+        m_outboundWasFull = true;
+        return false;
+    }
+
+    if (!m_outboundScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(
+            this, [this]() { drainOutbound(); }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+void MessageBusIoWorker::beginInboundDrain() { m_inboundScheduled = false; }
+
+bool MessageBusIoWorker::takeInbound(MessageBus::Message *message) {
+    return m_inbound.tryPop(message);
+}
+
+void MessageBusIoWorker::requestInboundBacklogFlush() {
+    if (m_inboundBacklogged) {
+        QMetaObject::invokeMethod(
+            this, [this]() { flushInboundBacklog(); }, Qt::QueuedConnection);
+    }
+}
+
+bool MessageBusIoWorker::isConnected(MessageBus::Protocol protocol) const {
+    switch (protocol) {
+        case MessageBus::WebSocket:
+            return m_webSocketConnected;
+        case MessageBus::TCP:
+            return m_tcpConnected;
+        case MessageBus::HTTP:
+        case MessageBus::InProcess:
+            break;
+    }
+    return false;
+}
+
+QList<MessageBus::Message> MessageBusIoWorker::takeAllInbound() {
+    QList<MessageBus::Message> messages;
+    MessageBus::Message message;
+    while (m_inbound.tryPop(&message)) {
+        messages.append(message);
+    }
+    while (!m_inboundBacklog.isEmpty()) {
+        messages.append(m_inboundBacklog.dequeue());
+    }
+    m_inboundBacklogged = false;
+    return messages;
+}
+
+void MessageBusIoWorker::drainOutbound() {
+    // 先清除标志再读取, 保证清除之后提交的消息一定会再次唤醒
+    m_outboundScheduled = false;
+
+    Outbound item;
+    QList<MessageBus::Message> failed;
+    while (m_outbound.tryPop(&item)) {
+        // 提交后连接已断开时交还给 MessageBus, 不进入传输层的离线缓存,
+        // 否则队列上限、持久化和确认都管不到这条消息
+        const qint64 bytes =
+            isConnected(item.message.protocol)
+                ? MessageBus::writeMessage(m_webSocketClient, m_tcpClient,
+                                           item.message, item.format)
+                : -1;
+        if (bytes < 0) {
+            failed.append(item.message);
+        } else if (bytes > 0) {
+            m_writtenBytes[item.message.channel] += bytes;
+        }
+    }
+
+    if (!failed.isEmpty()) {
+        QMutexLocker locker(&m_failedMutex);
+        const bool notify = m_failedWrites.isEmpty();
+        m_failedWrites.append(failed);
+        locker.unlock();
+        if (notify) {
+            emit writeFailed();
+        }
+    }
+
+    if (m_outboundWasFull.exchange(false)) {
+        emit outboundSpaceAvailable();
+    }
+}
+
+QList<MessageBus::Message> MessageBusIoWorker::takeFailedWrites() {
+    QMutexLocker locker(&m_failedMutex);
+    QList<MessageBus::Message> failed;
+    failed.swap(m_failedWrites);
+    return failed;
+}
+
+QHash<QString, quint64> MessageBusIoWorker::takeWrittenBytes() {
+    QHash<QString, quint64> written;
+    written.swap(m_writtenBytes);
+    return written;
+}
+
+void MessageBusIoWorker::onFrameReceived(const QByteArray &frame,
+                                         MessageBus::Protocol protocol) {
+    MessageBus::Message message;
+    if (MessageBus::decodeMessage(frame, protocol, &message)) {
+        message.enqueuedAt = m_clock.nsecsElapsed();
+        pushInbound(message);
+    }
+}
+
+void MessageBusIoWorker::pushInbound(const MessageBus::Message &message) {
+    // 环形缓冲区已满或已有积压时先进入积压队列, 保持接收顺序
+    if (!m_inboundBacklog.isEmpty() || !m_inbound.tryPush(message)) {
+        m_inboundBacklog.enqueue(message);
+        m_inboundBacklogged = true;
+    }
+    notifyInbound();
+}
+
+void MessageBusIoWorker::flushInboundBacklog() {
+    while (!m_inboundBacklog.isEmpty() &&
+           m_inbound.tryPush(m_inboundBacklog.head())) {
+        m_inboundBacklog.dequeue();
+    }
+    m_inboundBacklogged = !m_inboundBacklog.isEmpty();
+    notifyInbound();
+}
+
+void MessageBusIoWorker::notifyInbound() {
+    if (!m_inboundScheduled.exchange(true)) {
+        emit inboundReady();
+    }
+}
\ No newline at end of file
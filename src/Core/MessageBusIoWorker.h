@@ -0,0 +1,84 @@
+#ifndef MESSAGEBUSIOWORKER_H
+#define MESSAGEBUSIOWORKER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <atomic>
+
+#include "Core/MessageBus.h"
+#include "Utils/SpscRing.h"
+
+// MessageBus 的 I/O 线程: 持有 WebSocket/TCP 传输, 负责编解码与收发.
+// 与 MessageBus 所在线程之间通过两个 SPSC 环形缓冲区交换消息,
+// 仅在缓冲区由空变为非空时发出一次唤醒, 不为每条消息排队信号.
+class MessageBusIoWorker : public QObject {
+    Q_OBJECT
+
+public:
+    struct Outbound {
+        MessageBus::Message message;
+        MessageBus::WireFormat format = MessageBus::Json;
+    };
+
+    static constexpr int DefaultRingCapacity = 4096;
+
+    // 构造时传输对象仍在调用线程, 之后随 worker 一起 moveToThread.
+    // clock 与 MessageBus 共用同一起点, 用于标记接收时间
+    MessageBusIoWorker(WebSocketClient *webSocketClient, TcpClient *tcpClient,
+                       const QElapsedTimer &clock,
+                       int ringCapacity = DefaultRingCapacity);
+
+    // 以下在 MessageBus 所在线程调用
+    bool submit(const MessageBus::Message &message,
+                MessageBus::WireFormat format);
+    // 开始读取前调用, 之后到达的消息会重新发出 inboundReady
+    void beginInboundDrain();
+    bool takeInbound(MessageBus::Message *message);
+    void requestInboundBacklogFlush();
+    bool isConnected(MessageBus::Protocol protocol) const;
+    // I/O 线程停止后取出全部未分发的入站消息
+    QList<MessageBus::Message> takeAllInbound();
+    // 取出未能写出的消息 (按提交顺序), 由 MessageBus 重新排队
+    QList<MessageBus::Message> takeFailedWrites();
+
+    // 以下在 I/O 线程调用
+    void drainOutbound();
+    // 取出并清零各频道写出的字节数
+    QHash<QString, quint64> takeWrittenBytes();
+
+signals:
+    void inboundReady();
+    void outboundSpaceAvailable();
+    // 失败列表由空变为非空时发出
+    void writeFailed();
+
+private:
+    WebSocketClient *m_webSocketClient;
+    TcpClient *m_tcpClient;
+    QElapsedTimer m_clock;
+    QHash<QString, quint64> m_writtenBytes;  // 仅 I/O 线程访问
+
+    SpscRing<Outbound> m_outbound;
+    SpscRing<MessageBus::Message> m_inbound;
+    QQueue<MessageBus::Message> m_inboundBacklog;  // 仅 I/O 线程访问
+    QMutex m_failedMutex;  // 写入失败很少发生, 不必使用无锁结构
+    QList<MessageBus::Message> m_failedWrites;
+
+    std::atomic<bool> m_webSocketConnected;
+    std::atomic<bool> m_tcpConnected;
+    std::atomic<bool> m_outboundScheduled;
+    std::atomic<bool> m_outboundWasFull;
+    std::atomic<bool> m_inboundScheduled;
+    std::atomic<bool> m_inboundBacklogged;
+
+    void onFrameReceived(const QByteArray &frame,
+                         MessageBus::Protocol protocol);
+    void pushInbound(const MessageBus::Message &message);
+    void notifyInbound();
+    void flushInboundBacklog();
+};
+
+#endif  // MESSAGEBUSIOWORKER_H
\ No newline at end of file
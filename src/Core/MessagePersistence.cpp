@@ -0,0 +1,246 @@
+#include "MessagePersistence.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+MessagePersistence::MessagePersistence(QObject *parent)
+    : QObject(parent),
+      m_worker(nullptr),
+      m_connectionName(QString("messagebus-%1").arg(
+          reinterpret_cast<quintptr>(this), 0, 16)),
+      m_flushTimer(nullptr),
+      m_totalCommitUs(0) {
+    m_thread.setObjectName("MessagePersistence");
+}
+
+MessagePersistence::~MessagePersistence() { stop(); }
+
+QList<MessagePersistence::Record> MessagePersistence::start(
+    const QString &databasePath, int flushIntervalMs) {
+    if (isRunning()) {
+        return QList<Record>();
+    }
+
+    m_worker = new QObject;
+    m_worker->moveToThread(&m_thread);
+    m_thread.start();
+
+    // 数据库连接只能在写线程中使用, 在那里读取并等待结果,
+    // 保证已保存的消息先于任何新消息恢复
+    QList<Record> records;
+    QMetaObject::invokeMethod(
+        m_worker,
+        [this, databasePath, flushIntervalMs, &records]() {
+            openDatabase(databasePath);
+            records = loadRecords();
+
+            m_flushTimer = new QTimer(m_worker);
+            connect(m_flushTimer, &QTimer::timeout, m_worker,
+                    [this]() { flush(); });
+            m_flushTimer->start(flushIntervalMs);
+        },
+        Qt::BlockingQueuedConnection);
+    return records;
+}
+
+void MessagePersistence::stop() {
+    if (!isRunning()) {
+        return;
+    }
+
+    QMetaObject::invokeMethod(
+        m_worker,
+        [this]() {
+            delete m_flushTimer;
+            m_flushTimer = nullptr;
+            flush();
+            closeDatabase();
+        },
+        Qt::BlockingQueuedConnection);
+
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+bool MessagePersistence::isRunning() const { return m_thread.isRunning(); }
+
+void MessagePersistence::insert(const Record &record) {
+    QMutexLocker locker(&m_mutex);
+    Operation op;
+    op.record = record;
+    op.isInsert = true;
+    m_pendingInserts.insert(record.id, m_pending.size());
+    m_pending.append(op);
+    m_stats.queueDepth = m_pending.size();
+}
+
+void MessagePersistence::remove(quint64 id) {
+    QMutexLocker locker(&m_mutex);
+
+    // 写入尚未落盘时直接抵消, 两条操作都不必执行
+    auto it = m_pendingInserts.find(id);
+    if (it != m_pendingInserts.end()) {
+        m_pending[it.value()].cancelled = true;
+        m_pendingInserts.erase(it);
+        return;
+    }
+
+    Operation op;
+    op.record.id = id;
+    op.isInsert = false;
+    m_pending.append(op);
+    m_stats.queueDepth = m_pending.size();
+}
+
+MessagePersistence::Stats MessagePersistence::stats() const {
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void MessagePersistence::openDatabase(const QString &databasePath) {
+    QSqlDatabase database =
+        QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    database.setDatabaseName(databasePath);
+    if (!database.open()) {
+        qWarning() << "MessagePersistence: cannot open" << databasePath
+                   << database.lastError().text();
+        return;
+    }
+
+    QSqlQuery query(database);
+    // synchronous 保持默认 FULL: 每次提交都 fsync, 持久性与原先一致,
+    // 由批量提交摊薄开销
+    query.exec("PRAGMA journal_mode=WAL");
+    // id 不作为 INTEGER PRIMARY KEY, 保留独立的 rowid 记录写入顺序
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS messages_v2 "
+        "(id INTEGER NOT NULL UNIQUE, channel TEXT, data BLOB, protocol "
+        "INTEGER, priority INTEGER, requires_ack INTEGER)");
+    migrateLegacyTable(database);
+
+    m_insertQuery.reset(new QSqlQuery(database));
+    m_insertQuery->prepare(
+        "INSERT OR REPLACE INTO messages_v2 (id, channel, data, protocol, "
+        "priority, requires_ack) "
+        "VALUES (:id, :channel, :data, :protocol, :priority, :requires_ack)");
+    m_deleteQuery.reset(new QSqlQuery(database));
+    m_deleteQuery->prepare("DELETE FROM messages_v2 WHERE id = :id");
+}
+
+void MessagePersistence::migrateLegacyTable(QSqlDatabase &database) {
+    // 旧版本以 UUID 文本作为 ID, 迁移时以原 rowid 作为新 ID
+    if (!database.tables().contains("messages")) {
+        return;
+    }
+
+    QSqlQuery query(database);
+    database.transaction();
+    const bool copied = query.exec(
+        "INSERT OR IGNORE INTO messages_v2 (id, channel, data, protocol, "
+        "priority, requires_ack) "
+        "SELECT rowid, channel, data, protocol, priority, requires_ack "
+        "FROM messages ORDER BY rowid");
+    if (!copied || !query.exec("DROP TABLE messages") || !database.commit()) {
+        qWarning() << "MessagePersistence: cannot migrate legacy table"
+                   << query.lastError().text();
+        database.rollback();
+    }
+}
+
+void MessagePersistence::closeDatabase() {
+    m_insertQuery.reset();
+    m_deleteQuery.reset();
+    {
+        QSqlDatabase database = QSqlDatabase::database(m_connectionName, false);
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+QList<MessagePersistence::Record> MessagePersistence::loadRecords() {
+    QList<Record> records;
+    QSqlDatabase database = QSqlDatabase::database(m_connectionName, false);
+    if (!database.isOpen()) {
+        return records;
+    }
+
+    // rowid 保证同一优先级内按写入顺序恢复
+    QSqlQuery query(
+        "SELECT * FROM messages_v2 ORDER BY priority DESC, rowid ASC",
+        database);
+    while (query.next()) {
+        Record record;
+        record.id = query.value("id").toULongLong();
+        record.channel = query.value("channel").toString();
+        record.data = QJsonDocument::fromJson(query.value("data").toByteArray())
+                          .toVariant();
+        record.protocol = query.value("protocol").toInt();
+        record.priority = query.value("priority").toInt();
+        record.requiresAck = query.value("requires_ack").toBool();
+        records.append(record);
+    }
+    return records;
+}
+
+void MessagePersistence::flush() {
+    QVector<Operation> ops;
+    {
+        QMutexLocker locker(&m_mutex);
+        ops.swap(m_pending);
+        m_pendingInserts.clear();
+        m_stats.queueDepth = 0;
+    }
+    if (ops.isEmpty() || !m_insertQuery) {
+        return;
+    }
+
+    QSqlDatabase database = QSqlDatabase::database(m_connectionName, false);
+    quint64 executed = 0;
+    database.transaction();
+    for (const Operation &op : ops) {
+        if (op.cancelled) {
+            continue;
+        }
+        if (op.isInsert) {
+            m_insertQuery->bindValue(":id",
+                                     static_cast<qint64>(op.record.id));
+            m_insertQuery->bindValue(":channel", op.record.channel);
+            m_insertQuery->bindValue(
+                ":data", QJsonDocument::fromVariant(op.record.data).toJson());
+            m_insertQuery->bindValue(":protocol", op.record.protocol);
+            m_insertQuery->bindValue(":priority", op.record.priority);
+            m_insertQuery->bindValue(":requires_ack", op.record.requiresAck);
+            m_insertQuery->exec();
+        } else {
+            m_deleteQuery->bindValue(":id",
+                                     static_cast<qint64>(op.record.id));
+            m_deleteQuery->exec();
+        }
+        ++executed;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!database.commit()) {
+        qWarning() << "MessagePersistence: commit failed"
+                   << database.lastError().text();
+    }
+
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+    QMutexLocker locker(&m_mutex);
+    ++m_stats.transactions;
+    m_stats.operations += executed;
+    m_stats.lastCommitUs = elapsedUs;
+    m_stats.maxCommitUs = qMax(m_stats.maxCommitUs, elapsedUs);
+    m_totalCommitUs += elapsedUs;
+    m_stats.avgCommitUs =
+        static_cast<double>(m_totalCommitUs) / m_stats.transactions;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef MESSAGEPERSISTENCE_H
+#define MESSAGEPERSISTENCE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVariant>
+#include <QVector>
+#include <memory>
+
+class QSqlDatabase;
+class QSqlQuery;
+class QTimer;
+
+// MessageBus 的 SQLite 持久化: 写入与删除在独立线程中按固定间隔批量提交,
+// 每批一个事务, 使用 WAL 模式和复用的预编译语句.
+// insert/remove 可在任意线程调用, 按调用顺序落盘.
+class MessagePersistence : public QObject {
+    Q_OBJECT
+
+public:
+    struct Record {
+        quint64 id = 0;
+        QString channel;
+        QVariant data;
+        int protocol = 0;
+        int priority = 0;
+        bool requiresAck = false;
+    };
+
+    struct Stats {
+        int queueDepth = 0;        // 尚未提交的操作数
+        quint64 transactions = 0;  // 已提交的事务数
+        quint64 operations = 0;    // 已落盘的写入/删除数
+        qint64 lastCommitUs = 0;   // 最近一次 COMMIT (含 fsync) 耗时
+        qint64 maxCommitUs = 0;
+        double avgCommitUs = 0.0;
+    };
+
+    explicit MessagePersistence(QObject *parent = nullptr);
+    ~MessagePersistence();
+
+    // 打开数据库并启动写线程, 同步返回已保存的消息 (按写入顺序),
+    // 调用方可在任何新消息入队之前恢复它们
+    QList<Record> start(const QString &databasePath, int flushIntervalMs = 50);
+    // 提交剩余操作并结束写线程
+    void stop();
+    bool isRunning() const;
+
+    void insert(const Record &record);
+    void remove(quint64 id);
+
+    Stats stats() const;
+
+private:
+    struct Operation {
+        Record record;
+        bool isInsert = true;
+        bool cancelled = false;
+    };
+
+    QThread m_thread;
+    QObject *m_worker;
+    QString m_connectionName;
+
+    // 以下仅在写线程中访问
+    QTimer *m_flushTimer;
+    std::unique_ptr<QSqlQuery> m_insertQuery;
+    std::unique_ptr<QSqlQuery> m_deleteQuery;
+
+    mutable QMutex m_mutex;
+    QVector<Operation> m_pending;
+    QHash<quint64, int> m_pendingInserts;  // id -> m_pending 下标
+    Stats m_stats;
+    qint64 m_totalCommitUs;
+
+    void openDatabase(const QString &databasePath);
+    void migrateLegacyTable(QSqlDatabase &database);
+    void closeDatabase();
+    QList<Record> loadRecords();
+    void flush();
+};
+
+#endif  // MESSAGEPERSISTENCE_H
\ No newline at end of file
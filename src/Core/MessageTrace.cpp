@@ -0,0 +1,219 @@
+#include "MessageTrace.h"
+
+#include <QDebug>
+#include <QtEndian>
+#include <climits>
+
+namespace {
+const char kTraceMagic[] = {'M', 'B', 'T', 'R'};
+constexpr uchar kTraceVersion = 1;
+constexpr int kTraceHeaderSize = 5;
+// 长度字段之后的定长部分: 时间(8) 方向(1) 协议(1)
+constexpr int kRecordFixedSize = 10;
+const QString kControlChannelPrefix = QStringLiteral("$bus/");
+}  // namespace
+
+MessageRecorder::~MessageRecorder() { close(); }
+
+bool MessageRecorder::open(const QString &path) {
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open trace file:" << path
+                   << m_file.errorString();
+        return false;
+    }
+
+    QByteArray header(kTraceMagic, sizeof(kTraceMagic));
+    header.append(static_cast<char>(kTraceVersion));
+    m_file.write(header);
+    m_recordCount = 0;
+    m_clock.start();
+    return true;
+}
+
+void MessageRecorder::close() {
+    if (m_file.isOpen()) {
+        m_file.flush();
+        m_file.close();
+    }
+}
+
+void MessageRecorder::record(const MessageBus::Message &message,
+                             Direction direction) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    const QByteArray frame =
+        MessageBus::encodeMessage(message, MessageBus::Cbor);
+    QByteArray head(4 + kRecordFixedSize, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(head.data());
+    qToBigEndian<quint32>(
+        static_cast<quint32>(kRecordFixedSize + frame.size()), out);
+    qToBigEndian<qint64>(m_clock.nsecsElapsed(), out + 4);
+    out[12] = static_cast<uchar>(direction);
+    out[13] = static_cast<uchar>(message.protocol);
+    // QFile 自带写缓冲, 分两次写入不会多一次系统调用
+    m_file.write(head);
+    m_file.write(frame);
+    ++m_recordCount;
+}
+
+MessageReplayer::MessageReplayer(MessageBus *bus, QObject *parent)
+    : QObject(parent),
+      m_bus(bus),
+      m_speed(OriginalSpeed),
+      m_includeOutbound(false),
+      m_running(false),
+      m_hasPending(false) {
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &MessageReplayer::replayDue);
+}
+
+bool MessageReplayer::open(const QString &path) {
+    stop();
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open trace file:" << path
+                   << m_file.errorString();
+        return false;
+    }
+
+    const QByteArray header = m_file.read(kTraceHeaderSize);
+    if (header.size() != kTraceHeaderSize ||
+        !header.startsWith(QByteArray(kTraceMagic, sizeof(kTraceMagic))) ||
+        static_cast<uchar>(header.at(4)) != kTraceVersion) {
+        qWarning() << "Invalid trace file:" << path;
+        m_file.close();
+        return false;
+    }
+    m_stats = Stats();
+    return true;
+}
+
+void MessageReplayer::setSpeed(Speed speed) { m_speed = speed; }
+
+void MessageReplayer::setIncludeOutbound(bool include) {
+    m_includeOutbound = include;
+}
+
+void MessageReplayer::start() {
+    if (m_running || !m_file.isOpen() || !m_bus) {
+        return;
+    }
+
+    // 每次都从第一条记录开始
+    m_file.seek(kTraceHeaderSize);
+    m_hasPending = false;
+    m_stats = Stats();
+    m_running = true;
+    m_clock.start();
+    replayDue();
+}
+
+void MessageReplayer::stop() {
+    if (!m_running) {
+        return;
+    }
+    m_timer.stop();
+    finish();
+}
+
+bool MessageReplayer::isRunning() const { return m_running; }
+
+MessageReplayer::Stats MessageReplayer::stats() const { return m_stats; }
+
+bool MessageReplayer::readRecord(Record *record) {
+    // 无法解码的记录直接跳过, 文件结束或最后一条不完整时返回 false
+    for (;;) {
+        uchar lengthBytes[4];
+        if (m_file.read(reinterpret_cast<char *>(lengthBytes), 4) != 4) {
+            return false;
+        }
+        const quint32 length = qFromBigEndian<quint32>(lengthBytes);
+        if (length < kRecordFixedSize) {
+            return false;
+        }
+        const QByteArray body = m_file.read(length);
+        if (body.size() != static_cast<qsizetype>(length)) {
+            return false;
+        }
+
+        const uchar *in = reinterpret_cast<const uchar *>(body.constData());
+        if (in[9] >= MessageBus::ProtocolCount) {
+            continue;
+        }
+        record->timestampNs = qFromBigEndian<qint64>(in);
+        record->direction = in[8] == MessageRecorder::Outbound
+                                ? MessageRecorder::Outbound
+                                : MessageRecorder::Inbound;
+        record->message = MessageBus::Message();
+        if (MessageBus::decodeMessage(
+                body.mid(kRecordFixedSize),
+                static_cast<MessageBus::Protocol>(in[9]),
+                &record->message)) {
+            return true;
+        }
+    }
+}
+
+void MessageReplayer::replayDue() {
+    for (int budget = BatchSize; budget > 0; --budget) {
+        // 订阅者可能在回调中停止回放或销毁总线
+        if (!m_running) {
+            return;
+        }
+        if (!m_bus) {
+            finish();
+            return;
+        }
+        if (!m_hasPending && !readRecord(&m_pending)) {
+            finish();
+            return;
+        }
+        m_hasPending = true;
+
+        if (m_speed == OriginalSpeed) {
+            const qint64 waitNs =
+                m_pending.timestampNs - m_clock.nsecsElapsed();
+            if (waitNs > 0) {
+                const qint64 waitMs = (waitNs + 999999) / 1000000;
+                m_timer.start(
+                    static_cast<int>(qMin<qint64>(waitMs, INT_MAX)));
+                return;
+            }
+        }
+        m_hasPending = false;
+
+        MessageBus::Message &message = m_pending.message;
+        if ((m_pending.direction == MessageRecorder::Outbound &&
+             !m_includeOutbound) ||
+            message.channel.startsWith(kControlChannelPrefix)) {
+            continue;
+        }
+        // 以回放时刻作为接收时间, 分发延迟统计仍然有意义
+        message.enqueuedAt = m_bus->m_clock.nsecsElapsed();
+        m_bus->distributeMessage(message);
+        ++m_stats.replayed;
+    }
+
+    // 让出事件循环, 使订阅者的排队调用得以执行
+    m_timer.start(0);
+}
+
+void MessageReplayer::finish() {
+    m_running = false;
+    m_hasPending = false;
+    m_stats.elapsedNs = m_clock.nsecsElapsed();
+    if (m_stats.elapsedNs > 0) {
+        m_stats.messagesPerSecond =
+            m_stats.replayed * 1e9 / static_cast<double>(m_stats.elapsedNs);
+    }
+    emit finished();
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef MESSAGETRACE_H
+#define MESSAGETRACE_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include "Core/MessageBus.h"
+
+// MessageBus 流量录制文件格式 (追加写入, 整数均为大端):
+//   文件头: "MBTR" + 版本 (u8)
+//   记录:   长度 (u32, 不含自身) + 时间 (i64, 自录制开始的纳秒)
+//           + 方向 (u8) + 协议 (u8) + 帧
+// 帧与线路格式相同: 普通消息为 CBOR, 二进制消息为二进制帧,
+// 读取时直接交给 MessageBus::decodeMessage
+
+// 录制器, 由 MessageBus 在收发路径上调用
+class MessageRecorder {
+public:
+    enum Direction { Inbound, Outbound };
+
+    MessageRecorder() = default;
+    ~MessageRecorder();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    void record(const MessageBus::Message &message, Direction direction);
+    quint64 recordCount() const { return m_recordCount; }
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+    quint64 m_recordCount = 0;
+};
+
+// 回放器: 把录制的接收消息重新送入 MessageBus 的分发流程,
+// 可按原始节奏回放, 也可尽快回放作为可重复的吞吐测试.
+// 控制频道 ($bus/...) 不会回放; 路由规则仍然生效, 可能经传输层发出
+class MessageReplayer : public QObject {
+    Q_OBJECT
+
+public:
+    enum Speed { OriginalSpeed, AsFastAsPossible };
+
+    struct Stats {
+        quint64 replayed = 0;
+        qint64 elapsedNs = 0;
+        double messagesPerSecond = 0.0;
+    };
+
+    explicit MessageReplayer(MessageBus *bus, QObject *parent = nullptr);
+
+    bool open(const QString &path);
+    void setSpeed(Speed speed);
+    // 同时回放录制的发送消息 (默认只回放接收消息)
+    void setIncludeOutbound(bool include);
+
+    void start();
+    void stop();
+    bool isRunning() const;
+    Stats stats() const;
+
+signals:
+    void finished();
+
+private:
+    // 尽快回放时每批处理的记录数, 批与批之间让出事件循环
+    static constexpr int BatchSize = 4096;
+
+    struct Record {
+        qint64 timestampNs = 0;
+        MessageRecorder::Direction direction = MessageRecorder::Inbound;
+        MessageBus::Message message;
+    };
+
+    QPointer<MessageBus> m_bus;
+    QFile m_file;
+    Speed m_speed;
+    bool m_includeOutbound;
+    bool m_running;
+    bool m_hasPending;
+    Record m_pending;  // 已读出但尚未到时间的记录
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    Stats m_stats;
+
+    bool readRecord(Record *record);
+    void replayDue();
+    void finish();
+};
+
+#endif  // MESSAGETRACE_H
\ No newline at end of file
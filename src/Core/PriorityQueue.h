@@ -0,0 +1,87 @@
+#ifndef PRIORITYQUEUE_H
+#define PRIORITYQUEUE_H
+
+#include <QQueue>
+#include <array>
+
+// 按优先级分层的 FIFO 队列: 每个优先级一个独立队列, 入队/出队均为 O(1),
+// 同一优先级内保持先进先出. Levels 越大优先级越高.
+template <typename T, int Levels>
+class PriorityQueue {
+public:
+    void enqueue(const T &item, int level) {
+        m_levels[clampLevel(level)].enqueue(item);
+        ++m_size;
+    }
+
+    // 放回所在优先级的队首 (用于发送失败后回退)
+    void prepend(const T &item, int level) {
+        m_levels[clampLevel(level)].prepend(item);
+        ++m_size;
+    }
+
+    // 取出最高优先级的队首元素, 调用前需确认非空
+    T dequeue() {
+        auto &queue = m_levels[highestNonEmpty()];
+        --m_size;
+        return queue.dequeue();
+    }
+
+    const T &head() const { return m_levels[highestNonEmpty()].head(); }
+
+    // 从指定优先级的队首开始查找第一个满足条件的元素并取出
+    template <typename Predicate>
+    bool takeFirstIf(int level, Predicate pred, T *out) {
+        auto &queue = m_levels[clampLevel(level)];
+        for (qsizetype i = 0; i < queue.size(); ++i) {
+            if (pred(queue.at(i))) {
+                *out = queue.takeAt(i);
+                --m_size;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Predicate>
+    int removeIf(Predicate pred) {
+        int removed = 0;
+        for (auto &queue : m_levels) {
+            removed += static_cast<int>(queue.removeIf(pred));
+        }
+        m_size -= removed;
+        return removed;
+    }
+
+    void clear() {
+        for (auto &queue : m_levels) {
+            queue.clear();
+        }
+        m_size = 0;
+    }
+
+    bool isEmpty() const { return m_size == 0; }
+    int size() const { return m_size; }
+    int sizeAt(int level) const {
+        return static_cast<int>(m_levels[clampLevel(level)].size());
+    }
+
+private:
+    std::array<QQueue<T>, Levels> m_levels;
+    int m_size = 0;
+
+    static int clampLevel(int level) {
+        return level < 0 ? 0 : (level >= Levels ? Levels - 1 : level);
+    }
+
+    int highestNonEmpty() const {
+        for (int level = Levels - 1; level > 0; --level) {
+            if (!m_levels[level].isEmpty()) {
+                return level;
+            }
+        }
+        return 0;
+    }
+};
+
+#endif  // PRIORITYQUEUE_H
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <vector>
+
+// 哈希时间轮: 按到期时间所在的刻度放入对应槽, 推进时只检查经过的槽.
+// 插入 O(1), 推进开销与经过的刻度数和到期条目数成正比,
+// 超过一圈的条目留在槽内, 下一圈再检查. 不支持删除, 由调用方在到期时
+// 核对自身记录的截止时间来忽略已取消或已重新调度的条目.
+template <typename T>
+class TimerWheel {
+public:
+    explicit TimerWheel(qint64 tickMs = 10, int slotCount = 512)
+        : m_tickMs(qMax<qint64>(1, tickMs)) {
+        int rounded = 1;
+        while (rounded < slotCount) {
+            rounded <<= 1;
+        }
+        m_slots.resize(rounded);
+        m_mask = rounded - 1;
+    }
+
+    void schedule(const T &value, qint64 deadlineMs) {
+        // 槽 t 存放 ((t-1)*tick, t*tick] 内到期的条目, 推进到 t 时均已到期
+        qint64 tick = (deadlineMs + m_tickMs - 1) / m_tickMs;
+        if (tick <= m_currentTick) {
+            tick = m_currentTick + 1;
+        }
+        m_slots[tick & m_mask].append(Entry{value, deadlineMs});
+        ++m_size;
+    }
+
+    // 推进到 nowMs, 到期条目追加到 expired
+    void advance(qint64 nowMs, QVector<T> *expired) {
+        const qint64 nowTick = nowMs / m_tickMs;
+        if (nowTick <= m_currentTick) {
+            return;
+        }
+
+        // 间隔超过一圈时每个槽检查一次即可
+        const qint64 steps =
+            qMin<qint64>(nowTick - m_currentTick, m_mask + 1);
+        for (qint64 i = 1; m_size > 0 && i <= steps; ++i) {
+            QVector<Entry> &slot = m_slots[(m_currentTick + i) & m_mask];
+            for (qsizetype j = 0; j < slot.size();) {
+                if (slot.at(j).deadline <= nowMs) {
+                    expired->append(slot.at(j).value);
+                    slot[j] = slot.last();
+                    slot.removeLast();
+                    --m_size;
+                } else {
+                    ++j;
+                }
+            }
+        }
+        m_currentTick = nowTick;
+    }
+
+    void clear() {
+        for (QVector<Entry> &slot : m_slots) {
+            slot.clear();
+        }
+        m_size = 0;
+    }
+
+    qint64 tickMs() const { return m_tickMs; }
+    bool isEmpty() const { return m_size == 0; }
+    int size() const { return m_size; }
+
+private:
+    struct Entry {
+        T value;
+        qint64 deadline;
+    };
+
+    std::vector<QVector<Entry>> m_slots;
+    qint64 m_tickMs;
+    qint64 m_mask = 0;
+    qint64 m_currentTick = 0;
+    int m_size = 0;
+};
+
+#endif  // TIMERWHEEL_H
\ No newline at end of file
@@ -0,0 +1,144 @@
+#ifndef TOPICTRIE_H
+#define TOPICTRIE_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// MQTT 风格的主题前缀树, 层级以 '/' 分隔:
+//   '+' 匹配恰好一层, '#' 匹配其后任意层 (包括零层), 只能出现在末尾
+// 匹配开销与主题深度相关, 与订阅数量无关. 以 '$' 开头的主题不匹配首层通配符.
+template <typename T>
+class TopicTrie {
+public:
+    TopicTrie() { m_nodes.append(Node()); }
+
+    static bool isWildcard(const QString &filter) {
+        return filter.contains(QLatin1Char('+')) ||
+               filter.contains(QLatin1Char('#'));
+    }
+
+    static bool isValidFilter(const QString &filter) {
+        const QStringList levels = filter.split(QLatin1Char('/'));
+        for (int i = 0; i < levels.size(); ++i) {
+            const QString &level = levels.at(i);
+            if (level == QLatin1String("#")) {
+                if (i != levels.size() - 1) {
+                    return false;
+                }
+            } else if (level != QLatin1String("+") &&
+                       (level.contains(QLatin1Char('+')) ||
+                        level.contains(QLatin1Char('#')))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void insert(const QString &filter, const T &value) {
+        const QStringList levels = filter.split(QLatin1Char('/'));
+        int node = 0;
+        for (const QString &level : levels) {
+            if (level == QLatin1String("#")) {
+                m_nodes[node].multiLevel.append(value);
+                ++m_size;
+                return;
+            }
+            node = child(node, level);
+        }
+        m_nodes[node].values.append(value);
+        ++m_size;
+    }
+
+    template <typename Predicate>
+    int removeIf(const QString &filter, Predicate pred) {
+        const QStringList levels = filter.split(QLatin1Char('/'));
+        int node = 0;
+        for (const QString &level : levels) {
+            if (level == QLatin1String("#")) {
+                return erase(m_nodes[node].multiLevel, pred);
+            }
+            node = level == QLatin1String("+")
+                       ? m_nodes[node].singleLevel
+                       : m_nodes[node].children.value(level, -1);
+            if (node < 0) {
+                return 0;
+            }
+        }
+        return erase(m_nodes[node].values, pred);
+    }
+
+    // 将匹配 topic 的所有值追加到 out
+    void match(const QString &topic, QVector<T> *out) const {
+        if (m_size == 0) {
+            return;
+        }
+        const QStringList levels = topic.split(QLatin1Char('/'));
+        const bool system = topic.startsWith(QLatin1Char('$'));
+        matchLevel(0, levels, 0, system, out);
+    }
+
+    bool isEmpty() const { return m_size == 0; }
+
+private:
+    struct Node {
+        QHash<QString, int> children;
+        int singleLevel = -1;     // '+' 子节点
+        QVector<T> values;        // 在此结束的过滤器
+        QVector<T> multiLevel;    // 以 '#' 结束的过滤器
+    };
+
+    QVector<Node> m_nodes;
+    int m_size = 0;
+
+    int child(int node, const QString &level) {
+        if (level == QLatin1String("+")) {
+            if (m_nodes[node].singleLevel < 0) {
+                m_nodes.append(Node());
+                m_nodes[node].singleLevel = m_nodes.size() - 1;
+            }
+            return m_nodes[node].singleLevel;
+        }
+
+        const int existing = m_nodes[node].children.value(level, -1);
+        if (existing >= 0) {
+            return existing;
+        }
+        m_nodes.append(Node());
+        const int created = m_nodes.size() - 1;
+        m_nodes[node].children.insert(level, created);
+        return created;
+    }
+
+    template <typename Predicate>
+    int erase(QVector<T> &values, Predicate pred) {
+        const int removed = static_cast<int>(values.removeIf(pred));
+        m_size -= removed;
+        return removed;
+    }
+
+    void matchLevel(int node, const QStringList &levels, int depth,
+                    bool system, QVector<T> *out) const {
+        const Node &current = m_nodes.at(node);
+        const bool allowWildcard = !(system && depth == 0);
+
+        if (allowWildcard) {
+            out->append(current.multiLevel);
+        }
+        if (depth == levels.size()) {
+            out->append(current.values);
+            return;
+        }
+
+        const int exact = current.children.value(levels.at(depth), -1);
+        if (exact >= 0) {
+            matchLevel(exact, levels, depth + 1, system, out);
+        }
+        if (allowWildcard && current.singleLevel >= 0) {
+            matchLevel(current.singleLevel, levels, depth + 1, system, out);
+        }
+    }
+};
+
+#endif  // TOPICTRIE_H
\ No newline at end of file
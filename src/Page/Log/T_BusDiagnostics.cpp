@@ -0,0 +1,215 @@
+#include "T_BusDiagnostics.h"
+
+#include <QHeaderView>
+#include <QStandardItemModel>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include "Core/MessageBus.h"
+#include "ElaTableView.h"
+#include "ElaText.h"
+
+namespace {
+constexpr int kRefreshIntervalMs = 1000;
+constexpr int kTitlePixelSize = 18;
+constexpr int kTextPixelSize = 14;
+constexpr int kTableMinimumHeight = 240;
+
+const char* const kProtocolNames[] = {"WebSocket", "TCP", "HTTP",
+                                      "InProcess"};
+const char* const kPriorityNames[] = {"Low", "Normal", "High", "Critical"};
+const char* const kPolicyNames[] = {"DropOldest", "DropNewest", "Block"};
+
+QString formatRate(double value) { return QString::number(value, 'f', 1); }
+
+QString formatLatency(const LatencyHistogram& histogram) {
+    if (histogram.count() == 0) {
+        return "无样本";
+    }
+    return QString("样本 %1  p50 %2us  p90 %3us  p99 %4us  p99.9 %5us  "
+                   "最大 %6us")
+        .arg(histogram.count())
+        .arg(histogram.percentileNanos(50) / 1000.0, 0, 'f', 1)
+        .arg(histogram.percentileNanos(90) / 1000.0, 0, 'f', 1)
+        .arg(histogram.percentileNanos(99) / 1000.0, 0, 'f', 1)
+        .arg(histogram.percentileNanos(99.9) / 1000.0, 0, 'f', 1)
+        .arg(histogram.maxNanos() / 1000.0, 0, 'f', 1);
+}
+
+ElaText* createTitle(const QString& text, QWidget* parent) {
+    auto* title = new ElaText(text, parent);
+    title->setWordWrap(false);
+    title->setTextPixelSize(kTitlePixelSize);
+    return title;
+}
+
+ElaTableView* createTable(QStandardItemModel* model, QWidget* parent) {
+    auto* table = new ElaTableView(parent);
+    table->setModel(model);
+    table->setMinimumHeight(kTableMinimumHeight);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->verticalHeader()->setHidden(true);
+    table->horizontalHeader()->setSectionResizeMode(
+        QHeaderView::ResizeToContents);
+    table->horizontalHeader()->setStretchLastSection(true);
+    return table;
+}
+}  // namespace
+
+T_BusDiagnosticsPage::T_BusDiagnosticsPage(QWidget* parent)
+    : T_BasePage(parent) {
+    setWindowTitle("BusDiagnostics");
+
+    _channelModel = new QStandardItemModel(this);
+    _channelModel->setHorizontalHeaderLabels(
+        {"频道", "发送 条/s", "发送 B/s", "接收 条/s", "接收 B/s", "已发送",
+         "已接收", "过滤丢弃", "路由转发"});
+    _channelTable = createTable(_channelModel, this);
+
+    _queueModel = new QStandardItemModel(this);
+    _queueModel->setHorizontalHeaderLabels(
+        {"协议", "优先级", "深度", "容量", "策略", "丢弃", "拒绝", "背压"});
+    _queueTable = createTable(_queueModel, this);
+
+    _latencyText = new ElaText(this);
+    _latencyText->setTextPixelSize(kTextPixelSize);
+    _latencyText->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    _refreshTimer = new QTimer(this);
+    _refreshTimer->setInterval(kRefreshIntervalMs);
+    connect(_refreshTimer, &QTimer::timeout, this,
+            &T_BusDiagnosticsPage::refresh);
+
+    auto* centralWidget = new QWidget(this);
+    centralWidget->setWindowTitle("总线诊断");
+    auto* centerLayout = new QVBoxLayout(centralWidget);
+    centerLayout->addWidget(createTitle("频道", this));
+    centerLayout->addSpacing(10);
+    centerLayout->addWidget(_channelTable);
+    centerLayout->addSpacing(15);
+    centerLayout->addWidget(createTitle("发送队列", this));
+    centerLayout->addSpacing(10);
+    centerLayout->addWidget(_queueTable);
+    centerLayout->addSpacing(15);
+    centerLayout->addWidget(createTitle("延迟", this));
+    centerLayout->addSpacing(10);
+    centerLayout->addWidget(_latencyText);
+    centerLayout->addStretch();
+    centerLayout->setContentsMargins(0, 0, 0, 0);
+    addCentralWidget(centralWidget, true, true, 0);
+}
+
+T_BusDiagnosticsPage::~T_BusDiagnosticsPage() = default;
+
+void T_BusDiagnosticsPage::setMessageBus(MessageBus* messageBus) {
+    _messageBus = messageBus;
+    refresh();
+}
+
+void T_BusDiagnosticsPage::showEvent(QShowEvent* event) {
+    T_BasePage::showEvent(event);
+    // 只在页面可见时采集, 隐藏时不占用总线线程
+    refresh();
+    _refreshTimer->start();
+}
+
+void T_BusDiagnosticsPage::hideEvent(QHideEvent* event) {
+    T_BasePage::hideEvent(event);
+    _refreshTimer->stop();
+}
+
+void T_BusDiagnosticsPage::refresh() {
+    if (!_messageBus) {
+        // 总线已销毁或被移除, 不再保留上一次的数值
+        _channelModel->setRowCount(0);
+        _queueModel->setRowCount(0);
+        _latencyText->setText("未连接消息总线");
+        return;
+    }
+    refreshChannels();
+    refreshQueues();
+    refreshLatency();
+}
+
+void T_BusDiagnosticsPage::refreshChannels() {
+    const QHash<QString, MessageBus::ChannelMetrics> metrics =
+        _messageBus->channelMetrics();
+    QStringList channels = metrics.keys();
+    channels.sort();
+
+    _channelModel->setRowCount(channels.size());
+    for (int row = 0; row < channels.size(); ++row) {
+        const MessageBus::ChannelMetrics& m = metrics.value(channels.at(row));
+        const QStringList cells = {channels.at(row),
+                                   formatRate(m.sentMessageRate),
+                                   formatRate(m.sentByteRate),
+                                   formatRate(m.receivedMessageRate),
+                                   formatRate(m.receivedByteRate),
+                                   QString::number(m.sentMessages),
+                                   QString::number(m.receivedMessages),
+                                   QString::number(m.filterDrops),
+                                   QString::number(m.routeHits)};
+        for (int column = 0; column < cells.size(); ++column) {
+            _channelModel->setItem(row, column,
+                                   new QStandardItem(cells.at(column)));
+        }
+    }
+}
+
+void T_BusDiagnosticsPage::refreshQueues() {
+    _queueModel->setRowCount(0);
+    for (int protocol = 0; protocol < MessageBus::ProtocolCount; ++protocol) {
+        for (int priority = MessageBus::Critical; priority >= MessageBus::Low;
+             --priority) {
+            const MessageBus::QueueStats stats = _messageBus->queueStats(
+                static_cast<MessageBus::Protocol>(protocol),
+                static_cast<MessageBus::Priority>(priority));
+            const QStringList cells = {
+                kProtocolNames[protocol],
+                kPriorityNames[priority],
+                QString::number(stats.depth),
+                stats.capacity > 0 ? QString::number(stats.capacity) : "-",
+                kPolicyNames[stats.policy],
+                QString::number(stats.dropped),
+                QString::number(stats.rejected),
+                stats.backpressure ? "是" : "否"};
+            QList<QStandardItem*> items;
+            for (const QString& cell : cells) {
+                items.append(new QStandardItem(cell));
+            }
+            _queueModel->appendRow(items);
+        }
+    }
+}
+
+void T_BusDiagnosticsPage::refreshLatency() {
+    const MessageBus::AckStats ack = _messageBus->ackStats();
+    const QString ackLine =
+        QString("待确认 %1/%2  已确认 %3  重传 %4  放弃 %5  SRTT %6ms")
+            .arg(ack.inFlight)
+            .arg(ack.window > 0 ? QString::number(ack.window) : "∞")
+            .arg(ack.acknowledged)
+            .arg(ack.retransmits)
+            .arg(ack.expired)
+            .arg(ack.smoothedRttMs, 0, 'f', 2);
+
+    const TcpClient::SendQueueStats tcp = _messageBus->tcpSendQueueStats();
+    const QString tcpLine =
+        QString("TCP 断线队列 %1 帧/%2 B (上限 %3)  丢弃 %4 帧/%5 B  "
+                "重连丢弃 %6  跳过心跳 %7")
+            .arg(tcp.queuedFrames)
+            .arg(tcp.queuedBytes)
+            .arg(tcp.limitBytes > 0 ? QString::number(tcp.limitBytes) : "∞")
+            .arg(tcp.droppedFrames)
+            .arg(tcp.droppedBytes)
+            .arg(tcp.discardedOnReconnect)
+            .arg(tcp.skippedHeartbeats);
+
+    _latencyText->setText(
+        QString("入队→发送: %1\n接收→分发: %2\n确认 RTT: %3\n%4\n%5")
+            .arg(formatLatency(_messageBus->sendLatencyHistogram()),
+                 formatLatency(_messageBus->dispatchLatencyHistogram()),
+                 formatLatency(_messageBus->ackRttHistogram()), ackLine,
+                 tcpLine));
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef T_BUSDIAGNOSTICS_H
+#define T_BUSDIAGNOSTICS_H
+
+#include <QPointer>
+
+#include "T_BasePage.h"
+
+class QStandardItemModel;
+class QTimer;
+class ElaTableView;
+class ElaText;
+class MessageBus;
+
+// MessageBus 运行指标: 频道收发速率、各队列深度与延迟分布, 每秒刷新
+class T_BusDiagnosticsPage : public T_BasePage {
+    Q_OBJECT
+public:
+    explicit T_BusDiagnosticsPage(QWidget* parent = nullptr);
+    ~T_BusDiagnosticsPage();
+
+    void setMessageBus(MessageBus* messageBus);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private:
+    void refresh();
+    void refreshChannels();
+    void refreshQueues();
+    void refreshLatency();
+
+    QPointer<MessageBus> _messageBus;  // 总线由外部持有, 销毁后自动置空
+    QTimer* _refreshTimer{nullptr};
+    QStandardItemModel* _channelModel{nullptr};
+    QStandardItemModel* _queueModel{nullptr};
+    ElaTableView* _channelTable{nullptr};
+    ElaTableView* _queueTable{nullptr};
+    ElaText* _latencyText{nullptr};
+};
+
+#endif  // T_BUSDIAGNOSTICS_H
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+
+// 多生产者/单消费者无锁队列 (Vyukov 链表算法), 无容量上限.
+// push 可在任意线程并发调用, 每次只做一次原子交换;
+// tryPop 和 isEmpty 只能由唯一的消费者线程调用.
+// 生产者完成交换但尚未链接节点的瞬间, 消费者可能暂时看不到该元素,
+// 调用方需在 push 之后再通知消费者.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : m_tail(new Node) { m_head.store(m_tail); }
+
+    ~MpscQueue() {
+        T value;
+        while (tryPop(&value)) {
+        }
+        delete m_tail;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T value) {
+        Node *node = new Node;
+        node->value = std::move(value);
+        Node *prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool tryPop(T *out) {
+        Node *next = m_tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        // next 成为新的哨兵节点, 值移出后释放旧哨兵
+        *out = std::move(next->value);
+        next->value = T();
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+    bool isEmpty() const {
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        T value;
+    };
+
+    alignas(64) std::atomic<Node *> m_head{nullptr};  // 生产者端
+    alignas(64) Node *m_tail;                         // 消费者端, 哨兵节点
+};
+
+#endif  // MPSCQUEUE_H
\ No newline at end of file
@@ -21,6 +21,7 @@
 
 #include "Page/Equipment/T_Switch.h"
 
+#include "Page/Log/T_BusDiagnostics.h"
 #include "Page/Log/T_LogPanel.h"
 
 #include "Page/Serial/T_SerialConfig.h"
@@ -117,6 +118,8 @@ void MainWindow::initContent() {
 
     _logPanelPage = new T_LogPanelPage(this);
 
+    _busDiagnosticsPage = new T_BusDiagnosticsPage(this);
+
     _settingPage = new T_Setting(this);
 
     _dataHistoryPage = new T_DataHistory(this);
@@ -149,6 +152,7 @@ void MainWindow::initContent() {
     addPageNode("SerialDebug", _serialDebugPage, ElaIconType::Plug);
 
     addPageNode("Log", _logPanelPage, ElaIconType::List);
+    addPageNode("BusDiagnostics", _busDiagnosticsPage, ElaIconType::Gauge);
 
     QString dataKey;
     addExpanderNode("Data", dataKey, ElaIconType::Database);
@@ -178,6 +182,10 @@ void MainWindow::initContent() {
              << ElaEventBus::getInstance()->getRegisteredEventsName();
 }
 
+void MainWindow::setMessageBus(MessageBus *messageBus) {
+    _busDiagnosticsPage->setMessageBus(messageBus);
+}
+
 void MainWindow::changeLanguage(const QString &languageCode) {
     // 卸载当前翻译
     qApp->removeTranslator(&translator);
@@ -17,6 +17,9 @@ class T_SerialDebugPage;
 class T_ImageViewerPage;
 
 class T_LogPanelPage;
+class T_BusDiagnosticsPage;
+
+class MessageBus;
 
 class T_DataHistory;
 
@@ -35,6 +38,9 @@ public:
     void initEdgeLayout();
     void initContent();
 
+    // 诊断页面显示的总线, 由创建总线的一方传入; 未设置时页面显示未连接
+    void setMessageBus(MessageBus *messageBus);
+
 private slots:
     void changeLanguage(const QString &languageCode);
 
@@ -46,6 +52,7 @@ private:
     T_SerialConfig *_serialConfigPage{nullptr};
     T_SerialDebugPage *_serialDebugPage{nullptr};
     T_LogPanelPage *_logPanelPage{nullptr};
+    T_BusDiagnosticsPage *_busDiagnosticsPage{nullptr};
     T_Setting *_settingPage{nullptr};
     T_DataHistory *_dataHistoryPage{nullptr};
 
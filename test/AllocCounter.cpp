@@ -0,0 +1,90 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<quint64> g_count{0};
+std::atomic<quint64> g_bytes{0};
+
+void record(std::size_t size) {
+    g_count.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+}  // namespace
+
+namespace AllocCounter {
+
+Snapshot snapshot() {
+    Snapshot result;
+    result.count = g_count.load(std::memory_order_relaxed);
+    result.bytes = g_bytes.load(std::memory_order_relaxed);
+    return result;
+}
+
+bool includesMalloc() {
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+}  // namespace AllocCounter
+
+#if defined(__GLIBC__)
+// 可执行文件中定义的 malloc 会被所有共享库 (包括 Qt) 优先解析,
+// 实际分配交给 glibc 的内部入口. operator new 经由 malloc 计数
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+
+void *malloc(std::size_t size) noexcept {
+    record(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size) noexcept {
+    record(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, std::size_t size) noexcept {
+    record(size);
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+void *operator new(std::size_t size) {
+#if !defined(__GLIBC__)
+    record(size);
+#endif
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+#if !defined(__GLIBC__)
+    record(size);
+#endif
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+// 测试用: 统计进程内的堆分配次数与字节数 (所有线程合计).
+// 把 AllocCounter.cpp 编入测试可执行文件即生效: 替换全局 operator new;
+// glibc 下同时拦截 malloc, 从而包含 QByteArray/QString 等 Qt 容器的分配
+namespace AllocCounter {
+
+struct Snapshot {
+    quint64 count = 0;
+    quint64 bytes = 0;
+};
+
+Snapshot snapshot();
+// 为 false 时只统计 operator new, Qt 容器的分配不在其中
+bool includesMalloc();
+
+}  // namespace AllocCounter
+
+#endif  // ALLOCCOUNTER_H
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <QtTest>
+
+#include "AllocCounter.h"
+#include "BusLoopback.h"
+#include "TcpFrameSink.h"
+
+// 经 TCP 发送二进制负载: sendBinaryMessage 对比把 QByteArray 放进
+// QVariant 的 sendMessage (JSON + base64). 统计从入队到写入套接字之间
+// 每条消息的分配次数与字节数, 并测量整体吞吐
+class BenchBinaryPayload : public QObject {
+    Q_OBJECT
+
+private slots:
+    void send_data();
+    void send();
+
+private:
+    static bool sendOne(MessageBus *bus, const QByteArray &payload,
+                        bool binary);
+};
+
+bool BenchBinaryPayload::sendOne(MessageBus *bus, const QByteArray &payload,
+                                 bool binary) {
+    const QString channel = QStringLiteral("camera/frame");
+    return binary ? bus->sendBinaryMessage(channel, payload, MessageBus::TCP)
+                  : bus->sendMessage(channel, payload, MessageBus::TCP);
+}
+
+void BenchBinaryPayload::send_data() {
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("binary");
+
+    for (int size : {64, 64 * 1024, 4 * 1024 * 1024}) {
+        QTest::addRow("%d binary", size) << size << true;
+        QTest::addRow("%d variant", size) << size << false;
+    }
+}
+
+void BenchBinaryPayload::send() {
+    QFETCH(int, size);
+    QFETCH(bool, binary);
+
+    TcpFrameSink sink;
+    QVERIFY(sink.listen());
+    MessageBus bus;
+    bus.setDispatchMode(MessageBus::EventDispatch);
+    bool connected = false;
+    connect(&bus, &MessageBus::connected, this,
+            [&connected](MessageBus::Protocol protocol) {
+                connected = connected || protocol == MessageBus::TCP;
+            });
+    bus.connectTcp("127.0.0.1", sink.port());
+    QTRY_VERIFY(connected);
+
+    const QByteArray payload(size, 'x');
+    const int count = size >= 1024 * 1024 ? 20 : 500;
+
+    // EventDispatch 下入队即同步编码并写入套接字, 只统计这一段;
+    // 每条之后让对端读走数据, 套接字缓冲区不会持续增长
+    quint64 allocations = 0;
+    quint64 allocatedBytes = 0;
+    for (int i = 0; i < count; ++i) {
+        const AllocCounter::Snapshot before = AllocCounter::snapshot();
+        QVERIFY(sendOne(&bus, payload, binary));
+        const AllocCounter::Snapshot after = AllocCounter::snapshot();
+        allocations += after.count - before.count;
+        allocatedBytes += after.bytes - before.bytes;
+        QVERIFY(BusLoopback::pumpUntil(
+            [&sink, i]() { return sink.received() == i + 1; }));
+    }
+    qInfo("%.1f allocs/msg, %.0f bytes allocated/msg (payload %d bytes)%s",
+          double(allocations) / count, double(allocatedBytes) / count, size,
+          AllocCounter::includesMalloc() ? "" : ", operator new only");
+
+    QBENCHMARK {
+        sink.resetCount();
+        for (int i = 0; i < count; ++i) {
+            sendOne(&bus, payload, binary);
+        }
+        QVERIFY(BusLoopback::pumpUntil(
+            [&sink, count]() { return sink.received() == count; }));
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchBinaryPayload)
+
+#include "BenchBinaryPayload.moc"
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include <QtTest>
+
+#include "Connection/DeflateCodec.h"
+#include "Core/MessageBus.h"
+
+// WebSocket 发送路径上每条消息的字节数与 CPU 开销:
+// 原先的文本帧 (UTF-8 -> QString -> UTF-8) 对比带预置字典的 deflate.
+// 压缩后的线上大小含 3 字节压缩帧头, 不含 WebSocket 帧头
+class BenchCompression : public QObject {
+    Q_OBJECT
+
+private slots:
+    void textFrame_data();
+    void textFrame();
+    void deflate_data();
+    void deflate();
+    void inflate_data();
+    void inflate();
+
+private:
+    static void addPayloads();
+    static QByteArray encode(const QString &channel, const QVariant &data);
+    static constexpr int kCompressedHeaderSize = 3;
+};
+
+QByteArray BenchCompression::encode(const QString &channel,
+                                    const QVariant &data) {
+    MessageBus::Message message;
+    message.channel = channel;
+    message.data = data;
+    message.messageId = 0x0123456789abcdefULL;
+    return MessageBus::encodeMessage(message, MessageBus::Json);
+}
+
+void BenchCompression::addPayloads() {
+    QTest::addColumn<QByteArray>("frame");
+
+    QTest::newRow("property") << encode(
+        "device/camera/main/property",
+        QVariantMap{{"device", "ZWO ASI2600MM"},
+                    {"property", "CCD_TEMPERATURE"},
+                    {"state", "Ok"},
+                    {"value", -10.25}});
+
+    QVariantMap status;
+    for (int i = 0; i < 16; ++i) {
+        status.insert(QStringLiteral("property%1").arg(i), i * 1.5);
+    }
+    status.insert("device", "ZWO ASI2600MM");
+    status.insert("state", "Busy");
+    status.insert("timestamp", qint64(1760000000123));
+    QTest::newRow("status") << encode("device/camera/main/status", status);
+
+    QVariantList stars;
+    for (int i = 0; i < 100; ++i) {
+        stars.append(QVariantMap{{"id", i},
+                                 {"ra", 83.633 + i * 0.01},
+                                 {"dec", 22.0145 - i * 0.01},
+                                 {"mag", 6.5 + (i % 40) * 0.1}});
+    }
+    QTest::newRow("star list")
+        << encode("solver/stars", QVariantMap{{"stars", stars}});
+}
+
+void BenchCompression::textFrame_data() { addPayloads(); }
+
+void BenchCompression::textFrame() {
+    QFETCH(QByteArray, frame);
+    qInfo("%lld bytes on the wire", static_cast<long long>(frame.size()));
+
+    // sendTextMessage 接收 QString, QWebSocket 内部再编码回 UTF-8
+    QByteArray wire;
+    QBENCHMARK { wire = QString::fromUtf8(frame).toUtf8(); }
+    QCOMPARE(wire, frame);
+}
+
+void BenchCompression::deflate_data() { addPayloads(); }
+
+void BenchCompression::deflate() {
+    QFETCH(QByteArray, frame);
+
+    DeflateCodec codec;
+    const QByteArray compressed = codec.compress(frame);
+    QVERIFY(!compressed.isEmpty());
+    const qsizetype wireSize = compressed.size() + kCompressedHeaderSize;
+    qInfo("%lld -> %lld bytes on the wire (%.1f%%)",
+          static_cast<long long>(frame.size()),
+          static_cast<long long>(wireSize), 100.0 * wireSize / frame.size());
+
+    QByteArray result;
+    QBENCHMARK { result = codec.compress(frame); }
+    QCOMPARE(result, compressed);
+}
+
+void BenchCompression::inflate_data() { addPayloads(); }
+
+void BenchCompression::inflate() {
+    QFETCH(QByteArray, frame);
+
+    DeflateCodec codec;
+    const QByteArray compressed = codec.compress(frame);
+    QByteArray result;
+    QBENCHMARK { QVERIFY(codec.decompress(compressed, &result)); }
+    QCOMPARE(result, frame);
+}
+
+QTEST_APPLESS_MAIN(BenchCompression)
+
+#include "BenchCompression.moc"
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include <QtTest>
+
+#include "BusLoopback.h"
+
+// 50 个频道共 200 个订阅者 (每频道 4 个), 经进程内传输收发,
+// 输出每秒分发的消息数. 槽订阅与回调订阅分别测量
+class BenchDispatch : public QObject {
+    Q_OBJECT
+
+public:
+    Q_INVOKABLE void onData(const QVariant &data) {
+        Q_UNUSED(data)
+        ++m_delivered;
+    }
+
+private slots:
+    void fiftyChannels_data();
+    void fiftyChannels();
+
+private:
+    static constexpr int kChannels = 50;
+    static constexpr int kSubscribers = 200;
+    static constexpr int kMessages = 20000;
+    qint64 m_delivered = 0;
+};
+
+void BenchDispatch::fiftyChannels_data() {
+    QTest::addColumn<bool>("callbacks");
+    QTest::newRow("slot") << false;
+    QTest::newRow("callback") << true;
+}
+
+void BenchDispatch::fiftyChannels() {
+    QFETCH(bool, callbacks);
+
+    BusLoopback loopback;
+    QVERIFY(loopback.open());
+
+    QStringList channels;
+    for (int i = 0; i < kChannels; ++i) {
+        channels.append(QStringLiteral("device/%1/property").arg(i));
+    }
+    for (int i = 0; i < kSubscribers; ++i) {
+        const QString &channel = channels.at(i % kChannels);
+        if (callbacks) {
+            loopback.receiver.subscribe(
+                channel, this,
+                [this](const QVariant &data) { onData(data); });
+        } else {
+            loopback.receiver.subscribe(channel, this, "onData");
+        }
+    }
+
+    const qint64 perRound = qint64(kMessages) * kSubscribers / kChannels;
+    qint64 messages = 0;
+    qint64 elapsedNs = 0;
+    QBENCHMARK {
+        m_delivered = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < kMessages; ++i) {
+            loopback.sender.sendMessage(channels.at(i % kChannels),
+                                        QVariantMap{{"value", i}},
+                                        MessageBus::InProcess);
+        }
+        QVERIFY(BusLoopback::pumpUntil(
+            [this, perRound]() { return m_delivered == perRound; }));
+        elapsedNs += timer.nsecsElapsed();
+        messages += kMessages;
+    }
+    qInfo("%.0f msgs/s, %.0f deliveries/s",
+          messages * 1e9 / elapsedNs,
+          messages * 1e9 / elapsedNs * kSubscribers / kChannels);
+}
+
+QTEST_GUILESS_MAIN(BenchDispatch)
+
+#include "BenchDispatch.moc"
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <QtTest>
+
+#include "AllocCounter.h"
+#include "BusLoopback.h"
+
+// 进程内传输上单频道 1/4/16 个订阅者的扇出: 每秒消息数与每条消息的
+// 分配次数 (含编码、环形缓冲区投递、解码和回调, 两端合计)
+class BenchFanOut : public QObject {
+    Q_OBJECT
+
+private slots:
+    void fanOut_data();
+    void fanOut();
+
+private:
+    static constexpr int kMessages = 20000;
+};
+
+void BenchFanOut::fanOut_data() {
+    QTest::addColumn<int>("subscribers");
+    QTest::newRow("1") << 1;
+    QTest::newRow("4") << 4;
+    QTest::newRow("16") << 16;
+}
+
+void BenchFanOut::fanOut() {
+    QFETCH(int, subscribers);
+
+    BusLoopback loopback;
+    QVERIFY(loopback.open());
+
+    qint64 delivered = 0;
+    for (int i = 0; i < subscribers; ++i) {
+        loopback.receiver.subscribe(
+            "mount/position", this,
+            [&delivered](const QVariant &) { ++delivered; });
+    }
+
+    const QVariantMap data{{"ra", 83.633}, {"dec", 22.0145}};
+    const qint64 expected = qint64(kMessages) * subscribers;
+    const auto burst = [&]() {
+        delivered = 0;
+        for (int i = 0; i < kMessages; ++i) {
+            loopback.sender.sendMessage("mount/position", data,
+                                        MessageBus::InProcess);
+        }
+        return BusLoopback::pumpUntil(
+            [&delivered, expected]() { return delivered == expected; });
+    };
+
+    // 预热一轮, 让频道记录和队列容量稳定下来再计数
+    QVERIFY(burst());
+    const AllocCounter::Snapshot before = AllocCounter::snapshot();
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(burst());
+    const qint64 elapsedNs = timer.nsecsElapsed();
+    const AllocCounter::Snapshot after = AllocCounter::snapshot();
+    qInfo("%.0f msgs/s, %.1f allocs/msg%s", kMessages * 1e9 / elapsedNs,
+          double(after.count - before.count) / kMessages,
+          AllocCounter::includesMalloc() ? "" : " (operator new only)");
+
+    QBENCHMARK { QVERIFY(burst()); }
+}
+
+QTEST_GUILESS_MAIN(BenchFanOut)
+
+#include "BenchFanOut.moc"
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include <QThread>
+#include <QtTest>
+#include <algorithm>
+
+#include "Core/MessageBus.h"
+#include "TcpFrameSink.h"
+
+// 总线以 5000 条/秒经 TCP 发送时, 主线程上 16ms 定时 "帧" 的实际间隔.
+// 对端在独立线程中接收, 主线程只承担总线本身的开销;
+// 分别测量 I/O 线程关闭 (编码与写入在主线程) 和开启两种情况
+class BenchIoThread : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void frameTimeUnderLoad_data();
+    void frameTimeUnderLoad();
+
+private:
+    static QVariantMap samplePayload();
+
+    static constexpr int kRate = 5000;  // 条/秒
+    static constexpr int kFrameMs = 16;
+    static constexpr int kDurationMs = 3000;
+    QThread m_peerThread;
+    QObject m_peerContext;
+    TcpFrameSink *m_sink = nullptr;
+    quint16 m_port = 0;
+};
+
+void BenchIoThread::initTestCase() {
+    m_peerThread.start();
+    m_peerContext.moveToThread(&m_peerThread);
+    QMetaObject::invokeMethod(
+        &m_peerContext,
+        [this]() {
+            m_sink = new TcpFrameSink;
+            if (m_sink->listen()) {
+                m_port = m_sink->port();
+            }
+        },
+        Qt::BlockingQueuedConnection);
+    QVERIFY(m_port != 0);
+}
+
+void BenchIoThread::cleanupTestCase() {
+    QThread *mainThread = thread();
+    QMetaObject::invokeMethod(
+        &m_peerContext,
+        [this, mainThread]() {
+            delete m_sink;
+            m_sink = nullptr;
+            m_peerContext.moveToThread(mainThread);
+        },
+        Qt::BlockingQueuedConnection);
+    m_peerThread.quit();
+    m_peerThread.wait();
+}
+
+QVariantMap BenchIoThread::samplePayload() {
+    // 约 500 字节 JSON, 与设备状态推送相当
+    QVariantMap payload;
+    for (int i = 0; i < 16; ++i) {
+        payload.insert(QStringLiteral("property%1").arg(i), i * 1.5);
+    }
+    payload.insert("device", "ZWO ASI2600MM");
+    payload.insert("histogram", QVariantList{12, 80, 311, 1024, 402, 37, 5});
+    return payload;
+}
+
+void BenchIoThread::frameTimeUnderLoad_data() {
+    QTest::addColumn<bool>("ioThread");
+    QTest::newRow("gui-thread") << false;
+    QTest::newRow("io-thread") << true;
+}
+
+void BenchIoThread::frameTimeUnderLoad() {
+    QFETCH(bool, ioThread);
+
+    MessageBus bus;
+    bus.setDispatchMode(MessageBus::EventDispatch);
+    bus.setIoThreadEnabled(ioThread);
+    bool connected = false;
+    connect(&bus, &MessageBus::connected, this,
+            [&connected](MessageBus::Protocol protocol) {
+                connected = connected || protocol == MessageBus::TCP;
+            });
+    bus.connectTcp("127.0.0.1", m_port);
+    QTRY_VERIFY(connected);
+
+    const QVariantMap payload = samplePayload();
+    QElapsedTimer clock;
+    clock.start();
+
+    // 每毫秒补足到目标速率应发送的条数
+    qint64 sent = 0;
+    QTimer load;
+    load.setTimerType(Qt::PreciseTimer);
+    load.setInterval(1);
+    connect(&load, &QTimer::timeout, this, [&]() {
+        const qint64 due = clock.elapsed() * kRate / 1000;
+        for (; sent < due; ++sent) {
+            bus.sendMessage("camera/status", payload, MessageBus::TCP);
+        }
+    });
+
+    QVector<double> intervals;
+    qint64 lastFrame = clock.nsecsElapsed();
+    QTimer frame;
+    frame.setTimerType(Qt::PreciseTimer);
+    frame.setInterval(kFrameMs);
+    connect(&frame, &QTimer::timeout, this, [&]() {
+        const qint64 now = clock.nsecsElapsed();
+        intervals.append((now - lastFrame) / 1e6);
+        lastFrame = now;
+    });
+
+    // QTest::qWait 每轮休眠 10ms, 会掩盖帧间隔, 这里直接运行事件循环
+    QEventLoop loop;
+    QTimer::singleShot(kDurationMs, &loop, &QEventLoop::quit);
+    load.start();
+    frame.start();
+    loop.exec();
+    load.stop();
+    frame.stop();
+
+    QVERIFY(!intervals.isEmpty());
+    std::sort(intervals.begin(), intervals.end());
+    const auto percentile = [&intervals](double p) {
+        return intervals.at(qMin<int>(intervals.size() - 1,
+                                      int(intervals.size() * p)));
+    };
+    qInfo("%.0f msgs/s sent; frame interval p50 %.2f ms, p95 %.2f ms, "
+          "max %.2f ms",
+          sent * 1000.0 / kDurationMs, percentile(0.50), percentile(0.95),
+          intervals.last());
+}
+
+QTEST_GUILESS_MAIN(BenchIoThread)
+
+#include "BenchIoThread.moc"
\ No newline at end of file
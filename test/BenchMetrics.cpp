@@ -0,0 +1,71 @@
+#include <QtTest>
+
+#include "BusLoopback.h"
+
+// 频道指标对收发路径的开销: 关闭指标、已订阅频道、以及 2000 个
+// 未订阅频道 (超出 MaxMetricsOnlyChannels 的部分计入 "$other")
+class BenchMetrics : public QObject {
+    Q_OBJECT
+
+private slots:
+    void sendAndReceive_data();
+    void sendAndReceive();
+
+private:
+    static constexpr int kMessages = 20000;
+};
+
+void BenchMetrics::sendAndReceive_data() {
+    QTest::addColumn<bool>("metrics");
+    QTest::addColumn<int>("channelCount");
+    QTest::addColumn<bool>("subscribed");
+
+    QTest::newRow("off") << false << 50 << true;
+    QTest::newRow("on, subscribed") << true << 50 << true;
+    QTest::newRow("on, 2000 unsubscribed") << true << 2000 << false;
+}
+
+void BenchMetrics::sendAndReceive() {
+    QFETCH(bool, metrics);
+    QFETCH(int, channelCount);
+    QFETCH(bool, subscribed);
+
+    BusLoopback loopback;
+    loopback.sender.setMetricsEnabled(metrics);
+    loopback.receiver.setMetricsEnabled(metrics);
+    QVERIFY(loopback.open());
+
+    QStringList channels;
+    for (int i = 0; i < channelCount; ++i) {
+        channels.append(QStringLiteral("device/%1/property").arg(i));
+        if (subscribed) {
+            loopback.receiver.subscribe(channels.last(), this,
+                                        [](const QVariant &) {});
+        }
+    }
+
+    qint64 received = 0;
+    connect(&loopback.receiver, &MessageBus::messageReceived, this,
+            [&received]() { ++received; });
+
+    const QVariantMap data{{"value", 1.5}};
+    QBENCHMARK {
+        received = 0;
+        for (int i = 0; i < kMessages; ++i) {
+            loopback.sender.sendMessage(channels.at(i % channelCount), data,
+                                        MessageBus::InProcess);
+        }
+        QVERIFY(BusLoopback::pumpUntil(
+            [&received]() { return received == kMessages; }));
+    }
+
+    if (metrics) {
+        const auto snapshot = loopback.receiver.channelMetrics();
+        qInfo("receiver tracks %lld channel entries",
+              static_cast<long long>(snapshot.size()));
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchMetrics)
+
+#include "BenchMetrics.moc"
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <QQueue>
+#include <QVariant>
+#include <QtTest>
+#include <algorithm>
+
+#include "Core/PriorityQueue.h"
+
+// 10 万条消息混合优先级入队后全部出队:
+// 分层 FIFO (PriorityQueue) 对比原先按优先级有序插入的单队列
+class BenchPriorityQueue : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void layeredFifo();
+    void sortedInsert();
+
+private:
+    // 与 MessageBus::Message 相近的大小和拷贝开销
+    struct Item {
+        QString channel;
+        QVariant data;
+        int priority = 0;
+        quint64 id = 0;
+    };
+
+    static constexpr int kLevels = 4;
+    static constexpr int kCount = 100000;
+    QVector<Item> m_items;
+};
+
+void BenchPriorityQueue::initTestCase() {
+    m_items.reserve(kCount);
+    for (int i = 0; i < kCount; ++i) {
+        Item item;
+        item.channel = QStringLiteral("device/camera/%1").arg(i % 50);
+        item.data = QVariantMap{{"value", i}};
+        // 多数为 Normal, 少量高优先级插队
+        item.priority = i % 10 == 0 ? 3 : (i % 4 == 0 ? 2 : 1);
+        item.id = static_cast<quint64>(i + 1);
+        m_items.append(item);
+    }
+}
+
+void BenchPriorityQueue::layeredFifo() {
+    quint64 checksum = 0;
+    QBENCHMARK {
+        PriorityQueue<Item, kLevels> queue;
+        for (const Item &item : m_items) {
+            queue.enqueue(item, item.priority);
+        }
+        int lastPriority = kLevels;
+        while (!queue.isEmpty()) {
+            const Item item = queue.dequeue();
+            QVERIFY(item.priority <= lastPriority);
+            lastPriority = item.priority;
+            checksum += item.id;
+        }
+    }
+    QVERIFY(checksum > 0);
+}
+
+void BenchPriorityQueue::sortedInsert() {
+    quint64 checksum = 0;
+    QBENCHMARK {
+        // 原实现: lower_bound 定位后 QQueue::insert, 每次移动其后所有元素
+        QQueue<Item> queue;
+        for (const Item &item : m_items) {
+            const auto it = std::upper_bound(
+                queue.begin(), queue.end(), item.priority,
+                [](int priority, const Item &queued) {
+                    return priority > queued.priority;
+                });
+            queue.insert(it, item);
+        }
+        int lastPriority = kLevels;
+        while (!queue.isEmpty()) {
+            const Item item = queue.dequeue();
+            QVERIFY(item.priority <= lastPriority);
+            lastPriority = item.priority;
+            checksum += item.id;
+        }
+    }
+    QVERIFY(checksum > 0);
+}
+
+QTEST_APPLESS_MAIN(BenchPriorityQueue)
+
+#include "BenchPriorityQueue.moc"
\ No newline at end of file
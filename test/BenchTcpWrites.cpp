@@ -0,0 +1,72 @@
+#include <QtTest>
+
+#include "BusLoopback.h"
+#include "Connection/Tcp.h"
+#include "TcpFrameSink.h"
+
+// 经本地回环发送 100 万条 32 字节的帧, 对比 TcpClient 的两种写入模式.
+// batch 为每轮事件循环提交的条数: 1 相当于稀疏的交互流量,
+// 1000 相当于批量推送, 此时合并缓冲区决定系统调用次数
+class BenchTcpWrites : public QObject {
+    Q_OBJECT
+
+private slots:
+    void smallWrites_data();
+    void smallWrites();
+
+private:
+    static constexpr int kMessages = 1000000;
+    static constexpr int kMessageSize = 32;
+};
+
+void BenchTcpWrites::smallWrites_data() {
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("batch");
+
+    const int lowLatency = TcpClient::LowLatency;
+    const int throughput = TcpClient::Throughput;
+    QTest::newRow("low-latency, 1/turn") << lowLatency << 1;
+    QTest::newRow("low-latency, 1000/turn") << lowLatency << 1000;
+    QTest::newRow("throughput, 1/turn") << throughput << 1;
+    QTest::newRow("throughput, 1000/turn") << throughput << 1000;
+}
+
+void BenchTcpWrites::smallWrites() {
+    QFETCH(int, mode);
+    QFETCH(int, batch);
+
+    TcpFrameSink sink;
+    QVERIFY(sink.listen());
+
+    TcpClient client;
+    client.setFramingMode(FrameBuffer::LengthPrefixed);
+    client.setWriteMode(static_cast<TcpClient::WriteMode>(mode));
+    bool connected = false;
+    connect(&client, &TcpClient::connected, this,
+            [&connected]() { connected = true; });
+    client.connectToHost("127.0.0.1", sink.port());
+    QTRY_VERIFY(connected);
+
+    const QByteArray message(kMessageSize, 'm');
+    qint64 elapsedNs = 0;
+    QBENCHMARK_ONCE {
+        QElapsedTimer timer;
+        timer.start();
+        int sent = 0;
+        while (sent < kMessages) {
+            for (int i = 0; i < batch && sent < kMessages; ++i, ++sent) {
+                client.sendData(message);
+            }
+            QCoreApplication::processEvents();
+        }
+        QVERIFY(BusLoopback::pumpUntil(
+            [&sink]() { return sink.received() == kMessages; }, 120000));
+        elapsedNs = timer.nsecsElapsed();
+    }
+    qInfo("%.0f msgs/s, %.1f MB/s on the wire", kMessages * 1e9 / elapsedNs,
+          kMessages * (kMessageSize + 4) * 1e3 / elapsedNs);
+}
+
+QTEST_GUILESS_MAIN(BenchTcpWrites)
+
+#include "BenchTcpWrites.moc"
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <QtTest>
+
+#include "Core/MessageBus.h"
+
+// 典型设备属性消息的 JSON/CBOR 编码与解码吞吐, 同时输出帧大小
+class BenchWireFormat : public QObject {
+    Q_OBJECT
+
+private slots:
+    void encode_data();
+    void encode();
+    void decode_data();
+    void decode();
+
+private:
+    static MessageBus::Message sampleMessage();
+    static void addFormats();
+};
+
+MessageBus::Message BenchWireFormat::sampleMessage() {
+    MessageBus::Message message;
+    message.channel = QStringLiteral("device/camera/main/property");
+    message.data = QVariantMap{
+        {"device", "ZWO ASI2600MM"},
+        {"property", "CCD_TEMPERATURE"},
+        {"state", "Ok"},
+        {"value", -10.25},
+        {"timestamp", qint64(1760000000123)},
+        {"exposure", QVariantMap{{"duration", 120.0}, {"gain", 100}}},
+    };
+    message.protocol = MessageBus::TCP;
+    message.priority = MessageBus::High;
+    message.messageId = 0x123456789abcULL;
+    message.requiresAck = true;
+    return message;
+}
+
+void BenchWireFormat::addFormats() {
+    QTest::addColumn<int>("format");
+    QTest::newRow("json") << static_cast<int>(MessageBus::Json);
+    QTest::newRow("cbor") << static_cast<int>(MessageBus::Cbor);
+}
+
+void BenchWireFormat::encode_data() { addFormats(); }
+
+void BenchWireFormat::encode() {
+    QFETCH(int, format);
+    const auto wireFormat = static_cast<MessageBus::WireFormat>(format);
+    const MessageBus::Message message = sampleMessage();
+
+    qInfo() << "frame size:"
+            << MessageBus::encodeMessage(message, wireFormat).size()
+            << "bytes";
+    QByteArray frame;
+    QBENCHMARK { frame = MessageBus::encodeMessage(message, wireFormat); }
+    QVERIFY(!frame.isEmpty());
+}
+
+void BenchWireFormat::decode_data() { addFormats(); }
+
+void BenchWireFormat::decode() {
+    QFETCH(int, format);
+    const MessageBus::Message original = sampleMessage();
+    const QByteArray frame = MessageBus::encodeMessage(
+        original, static_cast<MessageBus::WireFormat>(format));
+
+    MessageBus::Message decoded;
+    QBENCHMARK {
+        QVERIFY(MessageBus::decodeMessage(frame, MessageBus::TCP, &decoded));
+    }
+    QCOMPARE(decoded.channel, original.channel);
+    QCOMPARE(decoded.messageId, original.messageId);
+    QCOMPARE(decoded.priority, original.priority);
+    QCOMPARE(decoded.data.toMap().value("property").toString(),
+             QStringLiteral("CCD_TEMPERATURE"));
+}
+
+QTEST_APPLESS_MAIN(BenchWireFormat)
+
+#include "BenchWireFormat.moc"
\ No newline at end of file
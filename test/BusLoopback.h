@@ -0,0 +1,55 @@
+#ifndef BUSLOOPBACK_H
+#define BUSLOOPBACK_H
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <functional>
+
+#include "Core/MessageBus.h"
+
+// 测试用: 两个经 InProcess 直连的总线, 发送端入队即发送.
+// 在当前线程中运行, 需要 QCoreApplication (QTEST_GUILESS_MAIN)
+struct BusLoopback {
+    MessageBus sender;
+    MessageBus receiver;
+
+    BusLoopback() { sender.setDispatchMode(MessageBus::EventDispatch); }
+
+    // 连接并等待两端都发出 connected
+    bool open(int timeoutMs = 5000) {
+        int connectedCount = 0;
+        auto onConnected = [&connectedCount](MessageBus::Protocol protocol) {
+            if (protocol == MessageBus::InProcess) {
+                ++connectedCount;
+            }
+        };
+        const auto first = QObject::connect(&sender, &MessageBus::connected,
+                                            onConnected);
+        const auto second = QObject::connect(
+            &receiver, &MessageBus::connected, onConnected);
+        MessageBus::connectInProcess(&sender, &receiver);
+        const bool ok =
+            pumpUntil([&connectedCount]() { return connectedCount == 2; },
+                      timeoutMs);
+        QObject::disconnect(first);
+        QObject::disconnect(second);
+        return ok;
+    }
+
+    // 不睡眠地处理事件直到 done 成立; QTest::qWaitFor 每轮会休眠 10ms,
+    // 不适合计时
+    static bool pumpUntil(const std::function<bool()> &done,
+                          int timeoutMs = 10000) {
+        QElapsedTimer timer;
+        timer.start();
+        while (!done()) {
+            if (timer.hasExpired(timeoutMs)) {
+                return false;
+            }
+            QCoreApplication::processEvents();
+        }
+        return true;
+    }
+};
+
+#endif  // BUSLOOPBACK_H
\ No newline at end of file
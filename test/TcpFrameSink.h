@@ -0,0 +1,46 @@
+#ifndef TCPFRAMESINK_H
+#define TCPFRAMESINK_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "Connection/FrameBuffer.h"
+
+// 测试用: 本地 TCP 对端, 按 MessageBus 默认的长度前缀分帧并计数.
+// 不解码负载, 只接受一个连接
+class TcpFrameSink {
+public:
+    TcpFrameSink() : m_frames(FrameBuffer::LengthPrefixed), m_received(0) {
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server,
+                         [this]() { accept(); });
+    }
+
+    bool listen() { return m_server.listen(QHostAddress::LocalHost); }
+    quint16 port() const { return m_server.serverPort(); }
+
+    qint64 received() const { return m_received; }
+    void resetCount() { m_received = 0; }
+
+private:
+    void accept() {
+        QTcpSocket *socket = m_server.nextPendingConnection();
+        if (!socket) {
+            return;
+        }
+        m_frames.clear();
+        QObject::connect(socket, &QTcpSocket::readyRead, socket,
+                         [this, socket]() {
+                             m_frames.append(socket->readAll());
+                             QByteArray frame;
+                             while (m_frames.nextFrame(&frame)) {
+                                 ++m_received;
+                             }
+                         });
+    }
+
+    QTcpServer m_server;
+    FrameBuffer m_frames;
+    qint64 m_received;
+};
+
+#endif  // TCPFRAMESINK_H
\ No newline at end of file
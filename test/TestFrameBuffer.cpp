@@ -0,0 +1,126 @@
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include "Connection/FrameBuffer.h"
+
+// 以随机大小的分片喂入 10 MB 的帧流, 检查每一帧都被完整重组
+class TestFrameBuffer : public QObject {
+    Q_OBJECT
+
+private slots:
+    void reassemblesRandomChunks_data();
+    void reassemblesRandomChunks();
+    void encodeHeadMatchesEncode();
+    void rejectsOversizedFrame();
+
+private:
+    static QByteArray randomPayload(QRandomGenerator &random, int size,
+                                    bool text);
+};
+
+namespace {
+constexpr qsizetype kStreamSize = 10 * 1024 * 1024;
+constexpr int kMaxPayloadSize = 64 * 1024;
+constexpr int kMaxChunkSize = 96 * 1024;
+}  // namespace
+
+QByteArray TestFrameBuffer::randomPayload(QRandomGenerator &random, int size,
+                                          bool text) {
+    QByteArray payload(size, Qt::Uninitialized);
+    for (char &c : payload) {
+        // 文本帧不能包含分隔符
+        c = text ? static_cast<char>('a' + random.bounded(26))
+                 : static_cast<char>(random.bounded(256));
+    }
+    return payload;
+}
+
+void TestFrameBuffer::reassemblesRandomChunks_data() {
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<quint32>("seed");
+
+    QTest::newRow("length-prefixed")
+        << static_cast<int>(FrameBuffer::LengthPrefixed) << 1u;
+    QTest::newRow("length-prefixed-2")
+        << static_cast<int>(FrameBuffer::LengthPrefixed) << 2u;
+    QTest::newRow("newline-delimited")
+        << static_cast<int>(FrameBuffer::NewlineDelimited) << 3u;
+}
+
+void TestFrameBuffer::reassemblesRandomChunks() {
+    QFETCH(int, mode);
+    QFETCH(quint32, seed);
+    const auto framing = static_cast<FrameBuffer::Mode>(mode);
+    const bool text = framing == FrameBuffer::NewlineDelimited;
+    QRandomGenerator random(seed);
+
+    // 混合空帧、小帧和接近分片大小的大帧
+    QList<QByteArray> payloads;
+    QByteArray stream;
+    stream.reserve(kStreamSize + kMaxPayloadSize);
+    while (stream.size() < kStreamSize) {
+        const int size = random.bounded(8) == 0
+                             ? random.bounded(kMaxPayloadSize)
+                             : random.bounded(256);
+        payloads.append(randomPayload(random, size, text));
+        stream.append(FrameBuffer::encode(payloads.last(), framing));
+    }
+
+    FrameBuffer buffer(framing);
+    QList<QByteArray> frames;
+    QByteArray frame;
+    qsizetype offset = 0;
+    while (offset < stream.size()) {
+        // 分片大小覆盖 1 字节到跨越多个帧
+        const int chunk = random.bounded(4) == 0
+                              ? 1 + random.bounded(8)
+                              : 1 + random.bounded(kMaxChunkSize);
+        buffer.append(stream.mid(offset, chunk));
+        offset += chunk;
+        while (buffer.nextFrame(&frame)) {
+            frames.append(frame);
+        }
+        QVERIFY(!buffer.hasError());
+    }
+
+    QCOMPARE(buffer.bufferedBytes(), 0);
+    QCOMPARE(frames.size(), payloads.size());
+    for (int i = 0; i < payloads.size(); ++i) {
+        if (frames.at(i) != payloads.at(i)) {
+            QFAIL(qPrintable(QString("frame %1 differs (%2 vs %3 bytes)")
+                                 .arg(i)
+                                 .arg(frames.at(i).size())
+                                 .arg(payloads.at(i).size())));
+        }
+    }
+}
+
+void TestFrameBuffer::encodeHeadMatchesEncode() {
+    // 分段写出 (head + 负载) 与整体编码得到相同的字节流
+    const QByteArray header("header");
+    const QByteArray payload(1000, 'x');
+    QCOMPARE(FrameBuffer::encodeHead(header, payload.size(),
+                                     FrameBuffer::LengthPrefixed) +
+                 payload,
+             FrameBuffer::encode(header + payload,
+                                 FrameBuffer::LengthPrefixed));
+}
+
+void TestFrameBuffer::rejectsOversizedFrame() {
+    FrameBuffer buffer(FrameBuffer::LengthPrefixed, 16);
+    buffer.append(FrameBuffer::encode(QByteArray(17, 'x'),
+                                      FrameBuffer::LengthPrefixed));
+    QByteArray frame;
+    QVERIFY(!buffer.nextFrame(&frame));
+    QVERIFY(buffer.hasError());
+
+    buffer.clear();
+    buffer.append(FrameBuffer::encode(QByteArray(16, 'y'),
+                                      FrameBuffer::LengthPrefixed));
+    QVERIFY(buffer.nextFrame(&frame));
+    QCOMPARE(frame, QByteArray(16, 'y'));
+}
+
+QTEST_APPLESS_MAIN(TestFrameBuffer)
+
+#include "TestFrameBuffer.moc"
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <QtTest>
+#include <algorithm>
+
+#include "Connection/WebSocket.h"
+
+// 100 个客户端连接到本地 QWebSocketServer, 服务端同时断开全部连接
+// (模拟网关重启), 检查各客户端选定的重连等待的分布. 共两轮, 第二轮
+// 验证连接成功后退避已重置, 等待不会继续增长. 断言只依据选定的等待,
+// 实际到达时间受机器负载影响, 仅输出供参考
+class TestReconnectStorm : public QObject {
+    Q_OBJECT
+
+private slots:
+    void reconnectsAreSpread();
+
+private:
+    static constexpr int kClients = 100;
+    static constexpr int kInitialMs = 200;
+    static constexpr int kMaxMs = 5000;
+    static constexpr int kBucketMs = 50;
+};
+
+void TestReconnectStorm::reconnectsAreSpread() {
+    QWebSocketServer server("storm", QWebSocketServer::NonSecureMode);
+    server.setMaxPendingConnections(kClients);
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    QElapsedTimer clock;
+    clock.start();
+    QList<QWebSocket *> peers;
+    QVector<qint64> arrivals;
+    connect(&server, &QWebSocketServer::newConnection, this, [&]() {
+        while (server.hasPendingConnections()) {
+            peers.append(server.nextPendingConnection());
+            arrivals.append(clock.elapsed());
+        }
+    });
+
+    QObject owner;
+    QList<WebSocketClient *> clients;
+    // 每轮每个客户端第一次选定的等待; 重连失败后的再次退避不计入
+    QHash<WebSocketClient *, int> delays;
+    for (int i = 0; i < kClients; ++i) {
+        auto *client = new WebSocketClient(&owner);
+        client->setReconnectInterval(kInitialMs, kMaxMs);
+        connect(client, &WebSocketClient::reconnectScheduled, this,
+                [&delays, client](int msecs) {
+                    if (!delays.contains(client)) {
+                        delays.insert(client, msecs);
+                    }
+                });
+        client->connectToServer(server.serverUrl());
+        clients.append(client);
+    }
+    const auto allConnected = [&clients]() {
+        for (WebSocketClient *client : clients) {
+            if (!client->isConnected()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    QTRY_VERIFY_WITH_TIMEOUT(allConnected(), 10000);
+
+    for (int round = 0; round < 2; ++round) {
+        arrivals.clear();
+        delays.clear();
+        const qint64 droppedAt = clock.elapsed();
+        for (QWebSocket *peer : std::as_const(peers)) {
+            peer->abort();
+            peer->deleteLater();
+        }
+        peers.clear();
+
+        QTRY_COMPARE_WITH_TIMEOUT(arrivals.size(), kClients, 10000);
+        QTRY_VERIFY_WITH_TIMEOUT(allConnected(), 10000);
+        QCOMPARE(delays.size(), kClients);
+
+        QVector<int> chosen = delays.values().toVector();
+        std::sort(chosen.begin(), chosen.end());
+        QVector<int> buckets((chosen.last() - chosen.first()) / kBucketMs + 1,
+                             0);
+        for (int delay : std::as_const(chosen)) {
+            ++buckets[(delay - chosen.first()) / kBucketMs];
+        }
+        const int busiest = *std::max_element(buckets.begin(), buckets.end());
+
+        QStringList histogram;
+        for (int count : std::as_const(buckets)) {
+            histogram.append(QString::number(count));
+        }
+        std::sort(arrivals.begin(), arrivals.end());
+        qInfo("round %d: chosen delays %d to %d ms, per %d ms: %s; "
+              "arrivals %lld to %lld ms after the drop",
+              round + 1, chosen.first(), chosen.last(), kBucketMs,
+              qPrintable(histogram.join(' ')), arrivals.first() - droppedAt,
+              arrivals.last() - droppedAt);
+
+        // 等待在 [initial, initial * 3] 内随机: 第二轮仍不超过 initial * 3
+        // 说明退避在连接成功后已重置
+        QVERIFY(chosen.first() >= kInitialMs);
+        QVERIFY2(chosen.last() <= kInitialMs * 3,
+                 qPrintable(QString("delay %1 ms").arg(chosen.last())));
+        // 同步重连时全部落在同一个值, 分散时跨度接近 2 * initial,
+        // 每桶约 kClients / 8
+        QVERIFY2(chosen.last() - chosen.first() >= kInitialMs,
+                 qPrintable(QString("span %1 ms")
+                                .arg(chosen.last() - chosen.first())));
+        QVERIFY2(busiest <= kClients * 2 / 5,
+                 qPrintable(QString("%1 in one bucket").arg(busiest)));
+        // 定时器不会提前到期, 到达时间只检查下限
+        QVERIFY(arrivals.first() - droppedAt >= kInitialMs - kBucketMs);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestReconnectStorm)
+
+#include "TestReconnectStorm.moc"
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include <QtTest>
+
+#include "BusLoopback.h"
+#include "TcpFrameSink.h"
+
+// WebSocket 未连接时, 排在其后的 TCP 消息仍按原速率发出,
+// WebSocket 消息留在自己的队列中等待
+class TestSendQueues : public QObject {
+    Q_OBJECT
+
+private slots:
+    void tcpDrainsWhileWebSocketDown_data();
+    void tcpDrainsWhileWebSocketDown();
+
+private:
+    static qint64 sendTcp(MessageBus *bus, TcpFrameSink *sink,
+                          int webSocketPerTcp);
+    static constexpr int kMessages = 5000;
+};
+
+qint64 TestSendQueues::sendTcp(MessageBus *bus, TcpFrameSink *sink,
+                               int webSocketPerTcp) {
+    sink->resetCount();
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kMessages; ++i) {
+        // WebSocket 消息先入队, 单队列时会挡住其后的 TCP 消息
+        for (int j = 0; j < webSocketPerTcp; ++j) {
+            bus->sendMessage("ws/data", QVariantMap{{"value", i}},
+                             MessageBus::WebSocket);
+        }
+        bus->sendMessage("tcp/data", QVariantMap{{"value", i}},
+                         MessageBus::TCP);
+    }
+    if (!BusLoopback::pumpUntil(
+            [sink]() { return sink->received() == kMessages; })) {
+        return -1;
+    }
+    return timer.nsecsElapsed();
+}
+
+void TestSendQueues::tcpDrainsWhileWebSocketDown_data() {
+    QTest::addColumn<int>("mode");
+    QTest::newRow("timer") << static_cast<int>(MessageBus::TimerDispatch);
+    QTest::newRow("event") << static_cast<int>(MessageBus::EventDispatch);
+}
+
+void TestSendQueues::tcpDrainsWhileWebSocketDown() {
+    QFETCH(int, mode);
+
+    TcpFrameSink sink;
+    QVERIFY(sink.listen());
+
+    MessageBus bus;
+    bus.setDispatchMode(static_cast<MessageBus::DispatchMode>(mode));
+    bool connected = false;
+    connect(&bus, &MessageBus::connected, this,
+            [&connected](MessageBus::Protocol protocol) {
+                connected = connected || protocol == MessageBus::TCP;
+            });
+    bus.connectTcp("127.0.0.1", sink.port());
+    QTRY_VERIFY(connected);
+
+    const qint64 baselineNs = sendTcp(&bus, &sink, 0);
+    QVERIFY2(baselineNs > 0, "TCP messages were not delivered");
+    const qint64 blockedNs = sendTcp(&bus, &sink, 1);
+    QVERIFY2(blockedNs > 0,
+             "TCP messages were held behind the WebSocket queue");
+
+    QCOMPARE(bus.queueStats(MessageBus::WebSocket, MessageBus::Normal).depth,
+             kMessages);
+    QCOMPARE(bus.queueStats(MessageBus::TCP, MessageBus::Normal).depth, 0);
+    qInfo("TCP alone: %.0f msgs/s, with WebSocket down: %.0f msgs/s",
+          kMessages * 1e9 / baselineNs, kMessages * 1e9 / blockedNs);
+}
+
+QTEST_GUILESS_MAIN(TestSendQueues)
+
+#include "TestSendQueues.moc"
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <QCryptographicHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <QtTest>
+#include <memory>
+
+#include "Connection/WebSocket.h"
+
+// 以本地 QWebSocketServer 为对端检查 ping/pong 心跳:
+// RTT 统计、有入站流量时省去 ping、对端不再响应时的死链检测
+class TestWebSocketHeartbeat : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void measuresRtt();
+    void skipsPingsWhileTrafficFlows();
+    void detectsDeadLink();
+
+private:
+    QWebSocketServer *m_server = nullptr;
+    QList<QWebSocket *> m_peers;
+};
+
+namespace {
+// 完成握手后不再读取任何数据的对端, 因而不会回应 ping
+class SilentPeer {
+public:
+    SilentPeer() {
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server,
+                         [this]() { accept(); });
+    }
+
+    bool listen() { return m_server.listen(QHostAddress::LocalHost); }
+    quint16 port() const { return m_server.serverPort(); }
+
+private:
+    void accept() {
+        QTcpSocket *socket = m_server.nextPendingConnection();
+        auto request = std::make_shared<QByteArray>();
+        QObject::connect(socket, &QTcpSocket::readyRead, socket,
+                         [socket, request]() {
+                             request->append(socket->readAll());
+                             if (request->contains("\r\n\r\n")) {
+                                 socket->disconnect();
+                                 socket->write(handshake(*request));
+                             }
+                         });
+    }
+
+    static QByteArray handshake(const QByteArray &request) {
+        QByteArray key;
+        for (const QByteArray &line : request.split('\n')) {
+            if (line.toLower().startsWith("sec-websocket-key:")) {
+                key = line.mid(line.indexOf(':') + 1).trimmed();
+            }
+        }
+        const QByteArray accept =
+            QCryptographicHash::hash(
+                key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11",
+                QCryptographicHash::Sha1)
+                .toBase64();
+        return "HTTP/1.1 101 Switching Protocols\r\n"
+               "Upgrade: websocket\r\n"
+               "Connection: Upgrade\r\n"
+               "Sec-WebSocket-Accept: " +
+               accept + "\r\n\r\n";
+    }
+
+    QTcpServer m_server;
+};
+}  // namespace
+
+void TestWebSocketHeartbeat::init() {
+    m_server = new QWebSocketServer("heartbeat",
+                                    QWebSocketServer::NonSecureMode, this);
+    QVERIFY(m_server->listen(QHostAddress::LocalHost));
+    connect(m_server, &QWebSocketServer::newConnection, this, [this]() {
+        m_peers.append(m_server->nextPendingConnection());
+    });
+}
+
+void TestWebSocketHeartbeat::cleanup() {
+    qDeleteAll(m_peers);
+    m_peers.clear();
+    delete m_server;
+    m_server = nullptr;
+}
+
+void TestWebSocketHeartbeat::measuresRtt() {
+    WebSocketClient client;
+    client.setHeartbeatInterval(20);
+    client.connectToServer(m_server->serverUrl());
+
+    QTRY_VERIFY_WITH_TIMEOUT(client.latencyStats().samples >= 20, 10000);
+    const WebSocketClient::LatencyStats stats = client.latencyStats();
+    QVERIFY(stats.pingsSent >= stats.samples);
+    QVERIFY(stats.smoothedUsecs > 0);
+    QVERIFY(stats.p50Usecs <= stats.p95Usecs);
+    QVERIFY(stats.p95Usecs <= stats.p99Usecs);
+    QVERIFY(stats.p99Usecs <= stats.maxUsecs);
+    QCOMPARE(stats.deadLinks, quint64(0));
+    qInfo("loopback RTT: smoothed %lld us, p50 %lld us, p99 %lld us",
+          stats.smoothedUsecs, stats.p50Usecs, stats.p99Usecs);
+}
+
+void TestWebSocketHeartbeat::skipsPingsWhileTrafficFlows() {
+    WebSocketClient client;
+    client.setHeartbeatInterval(50);
+    QSignalSpy connected(&client, &WebSocketClient::connected);
+    client.connectToServer(m_server->serverUrl());
+    QTRY_COMPARE(connected.count(), 1);
+    QTRY_COMPARE(m_peers.size(), 1);
+
+    // 对端每 5ms 推送一条消息, 远快于心跳周期
+    QTimer traffic;
+    connect(&traffic, &QTimer::timeout, this,
+            [this]() { m_peers.first()->sendTextMessage("{}"); });
+    traffic.start(5);
+    QTest::qWait(1000);
+    traffic.stop();
+
+    const WebSocketClient::LatencyStats stats = client.latencyStats();
+    QVERIFY(stats.pingsSkipped > 0);
+    // 连续跳过有上限, 仍会偶尔发出 ping 以刷新 RTT
+    QVERIFY(stats.pingsSkipped > stats.pingsSent);
+    QVERIFY(stats.pingsSent > 0);
+}
+
+void TestWebSocketHeartbeat::detectsDeadLink() {
+    SilentPeer peer;
+    QVERIFY(peer.listen());
+
+    WebSocketClient client;
+    client.setReconnectInterval(60000, 60000);
+    client.setHeartbeatInterval(50);
+    client.setDeadLinkDetection(4.0, 200);
+    QSignalSpy connected(&client, &WebSocketClient::connected);
+    QSignalSpy dead(&client, &WebSocketClient::deadLinkDetected);
+    client.connectToServer(
+        QUrl(QString("ws://127.0.0.1:%1").arg(peer.port())));
+    QTRY_COMPARE(connected.count(), 1);
+
+    QElapsedTimer timer;
+    timer.start();
+    QTRY_COMPARE_WITH_TIMEOUT(dead.count(), 1, 5000);
+    QVERIFY(dead.first().first().toLongLong() >= 200);
+    QCOMPARE(client.latencyStats().deadLinks, quint64(1));
+    qInfo("dead link detected after %lld ms", timer.elapsed());
+}
+
+QTEST_GUILESS_MAIN(TestWebSocketHeartbeat)
+
+#include "TestWebSocketHeartbeat.moc"
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <QtTest>
+
+#include "BusLoopback.h"
+
+// 对端发送大量不同主题时, 通配符订阅照常收到全部消息,
+// 但接收端登记的频道数量不随主题数增长
+class TestWildcardDispatch : public QObject {
+    Q_OBJECT
+
+private slots:
+    void manyTopicsStayBounded();
+    void resubscribeSeesNewMatches();
+};
+
+void TestWildcardDispatch::manyTopicsStayBounded() {
+    constexpr int kTopics = 3 * MessageBus::MaxMetricsOnlyChannels;
+
+    BusLoopback loopback;
+    QVERIFY(loopback.open());
+    int delivered = 0;
+    loopback.receiver.subscribe("camera/+/temp", this,
+                                [&delivered](const QVariant &) {
+                                    ++delivered;
+                                });
+
+    for (int i = 0; i < kTopics; ++i) {
+        loopback.sender.sendMessage(QStringLiteral("camera/%1/temp").arg(i),
+                                    -10.0, MessageBus::InProcess);
+    }
+    QVERIFY(BusLoopback::pumpUntil(
+        [&delivered]() { return delivered == kTopics; }));
+
+    // 超出上限的主题只计入 OtherChannelsKey
+    const auto metrics = loopback.receiver.channelMetrics();
+    QVERIFY(metrics.size() <= MessageBus::MaxMetricsOnlyChannels + 1);
+    QVERIFY(metrics.contains(MessageBus::OtherChannelsKey));
+}
+
+void TestWildcardDispatch::resubscribeSeesNewMatches() {
+    BusLoopback loopback;
+    QVERIFY(loopback.open());
+    int first = 0;
+    int second = 0;
+    QObject firstContext;
+    loopback.receiver.subscribe("mount/#", &firstContext,
+                                [&first](const QVariant &) { ++first; });
+
+    loopback.sender.sendMessage("mount/ra", 1.0, MessageBus::InProcess);
+    QVERIFY(BusLoopback::pumpUntil([&first]() { return first == 1; }));
+
+    // 订阅变化后缓存的匹配结果失效, 新旧订阅者都能收到
+    loopback.receiver.subscribe("mount/+", this,
+                                [&second](const QVariant &) { ++second; });
+    loopback.sender.sendMessage("mount/ra", 2.0, MessageBus::InProcess);
+    QVERIFY(BusLoopback::pumpUntil(
+        [&first, &second]() { return first == 2 && second == 1; }));
+
+    loopback.receiver.unsubscribe("mount/#", &firstContext);
+    loopback.sender.sendMessage("mount/ra", 3.0, MessageBus::InProcess);
+    QVERIFY(BusLoopback::pumpUntil([&second]() { return second == 2; }));
+    QCOMPARE(first, 2);
+}
+
+QTEST_GUILESS_MAIN(TestWildcardDispatch)
+
+#include "TestWildcardDispatch.moc"
\ No newline at end of file